@@ -0,0 +1,379 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "BinaryProtocol.hpp"
+#include "SymbolTable.hpp"
+
+// The trade layout of tapes and binary output for a historical trade print; the aggressor side is returned
+// separately.
+inline dxf_trade_t tradeFromTimeAndSale(const dxf_time_and_sale_t &t, std::uint8_t &aggressorSide) {
+    dxf_trade_t trade{};
+
+    trade.time = t.time;
+    trade.sequence = t.sequence;
+    trade.time_nanos = t.time_nanos;
+    trade.exchange_code = t.exchange_code;
+    trade.price = t.price;
+    trade.size = t.size;
+    trade.raw_flags = t.raw_flags;
+    trade.is_eth = t.is_eth_trade;
+    trade.scope = t.scope;
+    aggressorSide = t.side == dxf_osd_buy    ? binproto::SIDE_BUY
+                    : t.side == dxf_osd_sell ? binproto::SIDE_SELL
+                                             : binproto::SIDE_UNKNOWN;
+
+    return trade;
+}
+
+struct BackfillConfig {
+    std::string address{};
+    std::int64_t from{0};// ms since epoch, inclusive
+    std::int64_t to{0};  // ms since epoch, exclusive; the live stream continues from here
+    std::size_t connections{4};
+    std::size_t symbolsPerChunk{256};
+    std::chrono::milliseconds quiet{std::chrono::seconds(2)};
+    std::chrono::milliseconds chunkTimeout{std::chrono::seconds(60)};
+};
+
+struct BackfillStats {
+    std::size_t chunks{0};
+    std::size_t failedChunks{0};
+    std::size_t connections{0};
+    std::size_t events{0};
+    std::size_t heldLiveEvents{0};
+    bool live{false};// the live subscription was opened
+    std::int64_t elapsedMillis{0};
+};
+
+// Fetches the trade prints (TimeAndSale) of a symbol set over a time window and then continues with the live stream.
+// The symbol set is split into groups of `symbolsPerChunk`; each chunk is fetched by a timed subscription on one of
+// `connections` parallel connections and is complete when every symbol's snapshot has ended, or after `quiet` without
+// events. The window itself is not split: a timed subscription streams everything from its start time to now, so time
+// slices of one group would each fetch the rest of the window again. The chunks' events are sorted into one stream per
+// symbol ordered by time and passed to the sink.
+//
+// The live subscription is opened from `to` before the chunks are fetched. Its events are held until the history has
+// been delivered and are passed on afterwards, so the sink sees each symbol's history followed by the live stream
+// without a gap or a duplicate.
+class Backfill {
+  public:
+    // Called with the events of one symbol, in time order; calls are serialized.
+    using Sink = std::function<void(dxf_const_string_t symbolName, const dxf_time_and_sale_t *events, int count)>;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        std::uint32_t symbolId{0};
+        dxf_time_and_sale_t data{};
+    };
+
+    struct Chunk {
+        Backfill *owner{nullptr};
+        std::vector<std::wstring> symbols{};
+        std::int64_t from{0};
+        std::int64_t to{0};
+        std::mutex mutex{};
+        std::condition_variable wakeup{};
+        std::vector<Event> events{};
+        std::unordered_set<std::uint32_t> ended{};// symbols whose snapshot has ended
+        Clock::time_point lastEvent{};
+        bool fetched{false};
+    };
+
+    SymbolTable &symbols;
+    BackfillConfig config;
+    Sink sink;
+    std::vector<std::unique_ptr<Chunk>> chunks{};
+    std::atomic<std::size_t> nextChunk{0};
+    std::atomic<bool> cancelled{false};
+
+    dxf_subscription_t live{nullptr};
+    std::mutex liveMutex{};
+    std::vector<Event> held{};
+    bool released{false};
+
+    // Pointer members are only valid inside the listener.
+    static dxf_time_and_sale_t detach(const dxf_time_and_sale_t &e) {
+        auto copy = e;
+
+        copy.exchange_sale_conditions = nullptr;
+        copy.buyer = nullptr;
+        copy.seller = nullptr;
+
+        return copy;
+    }
+
+    static bool before(const Event &a, const Event &b) {
+        if (a.symbolId != b.symbolId) {
+            return a.symbolId < b.symbolId;
+        }
+
+        if (a.data.time != b.data.time) {
+            return a.data.time < b.data.time;
+        }
+
+        return a.data.index < b.data.index;
+    }
+
+    static void onChunkEvents(int eventType, dxf_const_string_t symbolName, const dxf_event_data_t *data, int count,
+                              void *userData) {
+        if (eventType != DXF_ET_TIME_AND_SALE) {
+            return;
+        }
+
+        auto *chunk = static_cast<Chunk *>(userData);
+        auto *events = reinterpret_cast<const dxf_time_and_sale_t *>(data);
+        auto symbolId = chunk->owner->symbols.intern(symbolName).first;
+        bool ended = false;
+
+        {
+            std::lock_guard<std::mutex> lock{chunk->mutex};
+
+            for (int i = 0; i < count; i++) {
+                auto &e = events[i];
+
+                if ((e.event_flags & (dxf_ef_snapshot_end | dxf_ef_snapshot_snip)) != 0) {
+                    ended = chunk->ended.insert(symbolId).second;
+                }
+
+                if ((e.event_flags & dxf_ef_remove_event) == 0 && e.time >= chunk->from && e.time < chunk->to) {
+                    chunk->events.push_back(Event{symbolId, detach(e)});
+                }
+            }
+
+            chunk->lastEvent = Clock::now();
+        }
+
+        if (ended) {
+            chunk->wakeup.notify_one();
+        }
+    }
+
+    static void onLiveEvents(int eventType, dxf_const_string_t symbolName, const dxf_event_data_t *data, int count,
+                             void *userData) {
+        if (eventType != DXF_ET_TIME_AND_SALE) {
+            return;
+        }
+
+        auto *self = static_cast<Backfill *>(userData);
+        auto *events = reinterpret_cast<const dxf_time_and_sale_t *>(data);
+        std::vector<dxf_time_and_sale_t> accepted{};
+
+        for (int i = 0; i < count; i++) {
+            if ((events[i].event_flags & dxf_ef_remove_event) == 0 && events[i].time >= self->config.to) {
+                accepted.push_back(detach(events[i]));
+            }
+        }
+
+        if (accepted.empty()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{self->liveMutex};
+
+        if (!self->released) {
+            auto symbolId = self->symbols.intern(symbolName).first;
+
+            for (auto &e : accepted) {
+                self->held.push_back(Event{symbolId, e});
+            }
+
+            return;
+        }
+
+        self->sink(symbolName, accepted.data(), static_cast<int>(accepted.size()));
+    }
+
+    bool fetch(dxf_connection_t connection, Chunk &chunk) {
+        dxf_subscription_t subscription{nullptr};
+
+        if (dxf_create_subscription_timed(connection, DXF_ET_TIME_AND_SALE, chunk.from, &subscription) ==
+            DXF_FAILURE) {
+            return false;
+        }
+
+        std::vector<dxf_const_string_t> names{};
+
+        for (auto &s : chunk.symbols) {
+            names.push_back(s.c_str());
+        }
+
+        auto started = Clock::now();
+
+        chunk.lastEvent = started;
+
+        if (dxf_attach_event_listener(subscription, &Backfill::onChunkEvents, &chunk) == DXF_FAILURE ||
+            dxf_add_symbols(subscription, names.data(), static_cast<int>(names.size())) == DXF_FAILURE) {
+            dxf_close_subscription(subscription);
+
+            return false;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock{chunk.mutex};
+
+            while (!cancelled && chunk.ended.size() < chunk.symbols.size()) {
+                auto now = Clock::now();
+
+                if (now - chunk.lastEvent >= config.quiet || now - started >= config.chunkTimeout) {
+                    break;
+                }
+
+                chunk.wakeup.wait_for(lock, config.quiet);
+            }
+        }
+
+        dxf_close_subscription(subscription);
+
+        return true;
+    }
+
+    void runConnection() {
+        dxf_connection_t connection{nullptr};
+
+        if (dxf_create_connection(config.address.c_str(), nullptr, nullptr, nullptr, nullptr, nullptr, &connection) ==
+            DXF_FAILURE) {
+            return;
+        }
+
+        for (auto i = nextChunk++; i < chunks.size() && !cancelled; i = nextChunk++) {
+            chunks[i]->fetched = fetch(connection, *chunks[i]);
+        }
+
+        dxf_close_connection(connection);
+    }
+
+    // Emits `events`, sorted, as one sink call per symbol.
+    void emit(std::vector<Event> &events) {
+        std::sort(events.begin(), events.end(), before);
+
+        std::vector<dxf_time_and_sale_t> run{};
+
+        for (std::size_t i = 0; i < events.size();) {
+            auto symbolId = events[i].symbolId;
+
+            run.clear();
+
+            for (; i < events.size() && events[i].symbolId == symbolId; i++) {
+                // A snapshot may be resent (e.g. after a reconnect); keep the first copy.
+                if (run.empty() || run.back().index != events[i].data.index ||
+                    run.back().time != events[i].data.time) {
+                    run.push_back(events[i].data);
+                }
+            }
+
+            sink(symbols.name(symbolId).c_str(), run.data(), static_cast<int>(run.size()));
+        }
+    }
+
+  public:
+    Backfill(SymbolTable &symbols, BackfillConfig config, Sink sink)
+        : symbols(symbols), config(std::move(config)), sink(std::move(sink)) {
+    }
+
+    // Fetches the history on parallel connections, delivers it and switches to the live stream opened on
+    // `liveConnection`. Blocks until the history has been delivered.
+    BackfillStats run(dxf_connection_t liveConnection, const std::vector<std::wstring> &symbolSet) {
+        auto started = Clock::now();
+        BackfillStats stats{};
+        std::vector<dxf_const_string_t> names{};
+
+        for (auto &s : symbolSet) {
+            names.push_back(s.c_str());
+        }
+
+        stats.live =
+            dxf_create_subscription_timed(liveConnection, DXF_ET_TIME_AND_SALE, config.to, &live) != DXF_FAILURE &&
+            dxf_attach_event_listener(live, &Backfill::onLiveEvents, this) != DXF_FAILURE &&
+            dxf_add_symbols(live, names.data(), static_cast<int>(names.size())) != DXF_FAILURE;
+
+        auto groupSize = std::max<std::size_t>(config.symbolsPerChunk, 1);
+
+        for (std::size_t first = 0; first < symbolSet.size(); first += groupSize) {
+            auto begin = symbolSet.begin() + static_cast<std::ptrdiff_t>(first);
+            auto end = symbolSet.begin() + static_cast<std::ptrdiff_t>(std::min(symbolSet.size(), first + groupSize));
+
+            chunks.emplace_back(new Chunk{});
+
+            auto &chunk = *chunks.back();
+
+            chunk.owner = this;
+            chunk.symbols.assign(begin, end);
+            chunk.from = config.from;
+            chunk.to = config.to;
+        }
+
+        stats.chunks = chunks.size();
+        stats.connections = std::min(std::max<std::size_t>(config.connections, 1), chunks.size());
+
+        std::vector<std::thread> workers{};
+
+        for (std::size_t i = 0; i < stats.connections; i++) {
+            workers.emplace_back(&Backfill::runConnection, this);
+        }
+
+        for (auto &w : workers) {
+            w.join();
+        }
+
+        // Symbol groups are disjoint, so each chunk is emitted on its own.
+        for (auto &chunk : chunks) {
+            if (!chunk->fetched) {
+                stats.failedChunks++;
+            }
+
+            stats.events += chunk->events.size();
+            emit(chunk->events);
+            chunk->events = std::vector<Event>{};
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{liveMutex};
+
+            stats.heldLiveEvents = held.size();
+            emit(held);
+            held = std::vector<Event>{};
+            released = true;
+        }
+
+        stats.elapsedMillis =
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started).count();
+
+        return stats;
+    }
+
+    // Makes a running backfill finish its current chunks early.
+    void cancel() {
+        cancelled = true;
+    }
+
+    // Closes the live subscription; must be called before its connection is closed.
+    void close() {
+        if (live) {
+            dxf_close_subscription(live);
+            live = nullptr;
+        }
+    }
+
+    ~Backfill() {
+        close();
+    }
+};
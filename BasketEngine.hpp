@@ -0,0 +1,213 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <DXFeed.h>
+
+#include "SymbolTable.hpp"
+
+// Value of one basket as of the last update.
+struct BasketValue {
+    std::string name{};
+    double value{0.0};
+    std::size_t constituents{0};
+    std::size_t priced{0};// constituents with a price; the value is complete when priced == constituents
+    std::uint64_t updates{0};
+};
+
+// Weighted sums of constituent mid prices. A constituent quote changes each basket it belongs to by
+// weight * (new price - old price), so an update costs O(baskets of the symbol), not O(constituents). Every
+// `recomputeEvery` delta updates a basket is re-summed from its prices, which bounds the accumulated rounding error.
+class BasketEngine {
+    struct Basket {
+        std::string name{};
+        std::vector<double> weights{};
+        std::vector<double> prices{};// 0 until the constituent is priced
+        double value{0.0};
+        std::size_t priced{0};
+        std::uint64_t updates{0};
+        std::uint64_t sinceRecompute{0};
+
+        void recompute() {
+            double sum = 0.0;
+
+            for (std::size_t i = 0; i < weights.size(); i++) {
+                sum += weights[i] * prices[i];
+            }
+
+            value = sum;
+            sinceRecompute = 0;
+        }
+    };
+
+    struct Membership {
+        std::uint32_t basket;
+        std::uint32_t index;// constituent index within the basket
+    };
+
+    SymbolTable &symbols;
+    std::uint64_t recomputeEvery;
+    std::mutex mutex{};
+    std::vector<Basket> baskets{};
+    std::vector<std::vector<Membership>> memberships{};// by symbol id
+    std::vector<std::wstring> constituentSymbols{};
+
+  public:
+    explicit BasketEngine(SymbolTable &symbols, std::uint64_t recomputeEvery = 1024)
+        : symbols(symbols), recomputeEvery(recomputeEvery == 0 ? 1 : recomputeEvery) {
+    }
+
+    void add(const std::string &basketName, const std::wstring &symbol, double weight) {
+        auto symbolId = symbols.intern(symbol).first;
+        std::lock_guard<std::mutex> lock{mutex};
+        std::size_t b = 0;
+
+        while (b < baskets.size() && baskets[b].name != basketName) {
+            b++;
+        }
+
+        if (b == baskets.size()) {
+            baskets.emplace_back();
+            baskets.back().name = basketName;
+        }
+
+        if (symbolId >= memberships.size()) {
+            memberships.resize(symbolId + 1);
+        }
+
+        if (memberships[symbolId].empty()) {
+            constituentSymbols.push_back(symbol);
+        }
+
+        auto &basket = baskets[b];
+
+        memberships[symbolId].push_back(
+            Membership{static_cast<std::uint32_t>(b), static_cast<std::uint32_t>(basket.weights.size())});
+        basket.weights.push_back(weight);
+        basket.prices.push_back(0.0);
+    }
+
+    // Reads "<basket> <symbol> <weight>" lines; '#' starts a comment. Returns false if the file cannot be read or a
+    // line is malformed (reported in `error`).
+    bool load(const std::string &path, std::string &error) {
+        std::ifstream in{path};
+
+        if (!in) {
+            error = "Cannot open " + path;
+
+            return false;
+        }
+
+        std::string line{};
+        int lineNumber = 0;
+
+        while (std::getline(in, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream fields{line};
+            std::string basket{};
+            std::string symbol{};
+            double weight = 0.0;
+
+            if (!(fields >> basket)) {
+                continue;
+            }
+
+            if (!(fields >> symbol >> weight)) {
+                error = fmt::format("{}:{}: expected <basket> <symbol> <weight>", path, lineNumber);
+
+                return false;
+            }
+
+            add(basket, std::wstring(symbol.begin(), symbol.end()), weight);
+        }
+
+        return true;
+    }
+
+    std::vector<std::wstring> subscriptionSymbols() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        return constituentSymbols;
+    }
+
+    void onQuotes(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count) {
+        onQuotes(symbols.find(symbolName), quotes, count);
+    }
+
+    // `symbolId` is an id of the engine's symbol table.
+    void onQuotes(std::uint32_t symbolId, const dxf_quote_t *quotes, int count) {
+        if (count <= 0) {
+            return;
+        }
+
+        auto &q = quotes[count - 1];
+
+        if (!(q.bid_price > 0.0 && q.ask_price > 0.0)) {
+            return;
+        }
+
+        auto price = (q.bid_price + q.ask_price) / 2.0;
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId >= memberships.size()) {
+            return;
+        }
+
+        for (auto &m : memberships[symbolId]) {
+            auto &basket = baskets[m.basket];
+            auto &old = basket.prices[m.index];
+
+            if (old == price) {
+                continue;
+            }
+
+            if (old == 0.0) {
+                basket.priced++;
+            }
+
+            basket.value += basket.weights[m.index] * (price - old);
+            old = price;
+            basket.updates++;
+
+            if (++basket.sinceRecompute >= recomputeEvery) {
+                basket.recompute();
+            }
+        }
+    }
+
+    void snapshot(std::vector<BasketValue> &out) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        out.clear();
+
+        for (auto &basket : baskets) {
+            out.push_back(BasketValue{basket.name, basket.value, basket.weights.size(), basket.priced, basket.updates});
+        }
+    }
+
+    std::string toText() {
+        std::vector<BasketValue> values{};
+        std::string text{};
+
+        snapshot(values);
+
+        for (auto &v : values) {
+            text += fmt::format("Basket {} = {:.6f} ({}/{} priced, {} updates)\n", v.name, v.value, v.priced,
+                                v.constituents, v.updates);
+        }
+
+        return text;
+    }
+};
@@ -0,0 +1,166 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+// Framed binary event stream written by `--binary`. This header is self-contained (no dxFeed dependency) so that
+// downstream consumers can include it as is.
+//
+// The stream is a sequence of frames. Each frame is a FrameHeader followed by `payloadSize` bytes:
+//  - SYMBOL frame: announces `symbolId`; the payload is the symbol name (`count` ASCII bytes, no terminator).
+//    A symbol frame always precedes the first events frame that references its id.
+//  - EVENTS frame: `count` packed records of the type given by `eventType` for the symbol `symbolId`.
+// All integers are little-endian: records are copied in host byte order, so writers and readers must run on a
+// little-endian host (checked below). Records have a fixed layout and no padding between them.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace binproto {
+
+constexpr std::uint32_t MAGIC = 0x46425844u;// "DXBF"
+
+enum FrameType : std::uint8_t {
+    FRAME_SYMBOL = 1,
+    FRAME_EVENTS = 2,
+};
+
+// Values match dxFeed's `dx_event_id_t`.
+enum EventType : std::uint8_t {
+    EVENT_TRADE = 0,
+    EVENT_QUOTE = 1,
+};
+
+#pragma pack(push, 1)
+
+struct FrameHeader {
+    std::uint32_t magic;
+    std::uint8_t frameType;
+    std::uint8_t eventType;
+    std::uint16_t reserved;
+    std::uint32_t symbolId;
+    std::uint32_t count;
+    std::uint32_t payloadSize;
+};
+
+struct QuoteRecord {
+    std::int64_t time;
+    std::int64_t bidTime;
+    std::int64_t askTime;
+    double bidPrice;
+    double bidSize;
+    double askPrice;
+    double askSize;
+    std::int32_t sequence;
+    std::int32_t timeNanos;
+    std::uint16_t bidExchangeCode;
+    std::uint16_t askExchangeCode;
+    std::uint8_t scope;
+    std::uint8_t reserved[3];
+};
+
+// Aggressor side derived by trade classification (see TradeClassifier.hpp).
+enum AggressorSide : std::uint8_t {
+    SIDE_UNKNOWN = 0,
+    SIDE_BUY = 1,
+    SIDE_SELL = 2,
+};
+
+struct TradeRecord {
+    std::int64_t time;
+    double price;
+    double size;
+    double dayVolume;
+    std::int32_t sequence;
+    std::int32_t timeNanos;
+    std::uint16_t exchangeCode;
+    std::uint8_t direction;
+    std::uint8_t scope;
+    std::uint8_t aggressorSide;
+    std::uint8_t reserved[3];
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(FrameHeader) == 20, "FrameHeader layout changed");
+static_assert(sizeof(QuoteRecord) == 72, "QuoteRecord layout changed");
+static_assert(sizeof(TradeRecord) == 48, "TradeRecord layout changed");
+
+// MSVC targets are all little-endian and do not define these.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the binary protocol is little-endian");
+#endif
+
+// Minimal pull reader over a FILE* (stdin, a pipe or a file). Resolves symbol ids using the dictionary frames.
+//
+//    binproto::Reader reader{stdin};
+//    while (reader.next()) {
+//        if (reader.header().eventType == binproto::EVENT_QUOTE) {
+//            auto *quotes = reader.records<binproto::QuoteRecord>();
+//            ...
+//        }
+//    }
+class Reader {
+    std::FILE *in;
+    FrameHeader current{};
+    std::vector<char> payload{};
+    std::unordered_map<std::uint32_t, std::string> symbols{};
+
+  public:
+    explicit Reader(std::FILE *in) : in(in) {
+    }
+
+    // Advances to the next events frame, consuming symbol frames on the way. Returns false on EOF or corruption.
+    bool next() {
+        while (std::fread(&current, sizeof(current), 1, in) == 1) {
+            if (current.magic != MAGIC) {
+                return false;
+            }
+
+            payload.resize(current.payloadSize);
+
+            if (current.payloadSize != 0 && std::fread(payload.data(), current.payloadSize, 1, in) != 1) {
+                return false;
+            }
+
+            if (current.frameType == FRAME_SYMBOL) {
+                symbols[current.symbolId] = std::string(payload.begin(), payload.end());
+
+                continue;
+            }
+
+            if (current.frameType == FRAME_EVENTS) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const FrameHeader &header() const {
+        return current;
+    }
+
+    const std::string &symbol() const {
+        static const std::string unknown{};
+        auto found = symbols.find(current.symbolId);
+
+        return found == symbols.end() ? unknown : found->second;
+    }
+
+    // The payload is byte-aligned; copy records out if the platform requires aligned access.
+    template<typename Record>
+    const Record *records() const {
+        return reinterpret_cast<const Record *>(payload.data());
+    }
+
+    std::size_t recordCount() const {
+        return current.count;
+    }
+};
+
+}// namespace binproto
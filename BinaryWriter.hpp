@@ -0,0 +1,195 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "BinaryProtocol.hpp"
+#include "SymbolTable.hpp"
+
+// Appends binary protocol frames to a byte buffer. Tracks which symbol ids were already announced on its stream.
+class BinaryEncoder {
+    SymbolTable &symbols;
+    std::vector<bool> announced{};
+
+    static void append(std::vector<char> &out, const void *data, std::size_t size) {
+        auto *bytes = static_cast<const char *>(data);
+
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    static binproto::FrameHeader makeHeader(std::uint8_t frameType, std::uint8_t eventType, std::uint32_t symbolId,
+                                            std::uint32_t count, std::uint32_t payloadSize) {
+        binproto::FrameHeader header{};
+
+        header.magic = binproto::MAGIC;
+        header.frameType = frameType;
+        header.eventType = eventType;
+        header.symbolId = symbolId;
+        header.count = count;
+        header.payloadSize = payloadSize;
+
+        return header;
+    }
+
+  public:
+    explicit BinaryEncoder(SymbolTable &symbols) : symbols(symbols) {
+    }
+
+    // Emits a dictionary frame for the symbol id into `out` on its first use on this stream.
+    void announce(std::uint32_t id, std::vector<char> &out) {
+        if (id >= announced.size()) {
+            announced.resize(id + 1, false);
+        }
+
+        if (!announced[id]) {
+            std::string name{};
+
+            for (auto c : symbols.name(id)) {
+                name.push_back(static_cast<char>(c));
+            }
+
+            auto header = makeHeader(binproto::FRAME_SYMBOL, 0, id, static_cast<std::uint32_t>(name.size()),
+                                     static_cast<std::uint32_t>(name.size()));
+
+            append(out, &header, sizeof(header));
+            append(out, name.data(), name.size());
+            announced[id] = true;
+        }
+    }
+
+    static binproto::QuoteRecord toRecord(const dxf_quote_t &q) {
+        binproto::QuoteRecord r{};
+
+        r.time = q.time;
+        r.bidTime = q.bid_time;
+        r.askTime = q.ask_time;
+        r.bidPrice = q.bid_price;
+        r.bidSize = q.bid_size;
+        r.askPrice = q.ask_price;
+        r.askSize = q.ask_size;
+        r.sequence = q.sequence;
+        r.timeNanos = q.time_nanos;
+        r.bidExchangeCode = static_cast<std::uint16_t>(q.bid_exchange_code);
+        r.askExchangeCode = static_cast<std::uint16_t>(q.ask_exchange_code);
+        r.scope = static_cast<std::uint8_t>(q.scope);
+
+        return r;
+    }
+
+    static binproto::TradeRecord toRecord(const dxf_trade_t &t, std::uint8_t aggressorSide) {
+        binproto::TradeRecord r{};
+
+        r.time = t.time;
+        r.price = t.price;
+        r.size = t.size;
+        r.dayVolume = t.day_volume;
+        r.sequence = t.sequence;
+        r.timeNanos = t.time_nanos;
+        r.exchangeCode = static_cast<std::uint16_t>(t.exchange_code);
+        r.direction = static_cast<std::uint8_t>(t.direction);
+        r.scope = static_cast<std::uint8_t>(t.scope);
+        r.aggressorSide = aggressorSide;
+
+        return r;
+    }
+
+    void encodeQuotes(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count, std::vector<char> &out) {
+        encodeQuotes(symbols.intern(symbolName).first, quotes, count, out);
+    }
+
+    void encodeTrades(dxf_const_string_t symbolName, const dxf_trade_t *trades, int count,
+                      const std::uint8_t *aggressorSides, std::vector<char> &out) {
+        encodeTrades(symbols.intern(symbolName).first, trades, count, aggressorSides, out);
+    }
+
+    // `symbolId` is an id of the encoder's symbol table.
+    void encodeQuotes(std::uint32_t symbolId, const dxf_quote_t *quotes, int count, std::vector<char> &out) {
+        encode(symbolId, binproto::EVENT_QUOTE, count, out, [quotes](int i) {
+            return toRecord(quotes[i]);
+        });
+    }
+
+    // `aggressorSides` is optional (one binproto::AggressorSide per trade).
+    void encodeTrades(std::uint32_t symbolId, const dxf_trade_t *trades, int count, const std::uint8_t *aggressorSides,
+                      std::vector<char> &out) {
+        encode(symbolId, binproto::EVENT_TRADE, count, out, [trades, aggressorSides](int i) {
+            auto side = aggressorSides ? aggressorSides[i] : static_cast<std::uint8_t>(binproto::SIDE_UNKNOWN);
+
+            return toRecord(trades[i], side);
+        });
+    }
+
+  private:
+    template<typename MakeRecord>
+    void encode(std::uint32_t symbolId, std::uint8_t eventType, int count, std::vector<char> &out,
+                MakeRecord makeRecord) {
+        if (count <= 0) {
+            return;
+        }
+
+        using Record = decltype(makeRecord(0));
+
+        announce(symbolId, out);
+
+        auto payloadSize = static_cast<std::uint32_t>(sizeof(Record) * count);
+        auto header = makeHeader(binproto::FRAME_EVENTS, eventType, symbolId, static_cast<std::uint32_t>(count), payloadSize);
+
+        append(out, &header, sizeof(header));
+
+        auto offset = out.size();
+
+        out.resize(offset + payloadSize);
+
+        for (int i = 0; i < count; ++i) {
+            auto record = makeRecord(i);
+
+            std::memcpy(out.data() + offset + i * sizeof(record), &record, sizeof(record));
+        }
+    }
+};
+
+// Writes binary frames to a FILE* (normally stdout). One fwrite + fflush per listener call, so a downstream reader
+// sees whole batches as soon as they arrive.
+class BinaryWriter {
+    std::mutex mutex{};
+    std::FILE *out;
+    BinaryEncoder encoder;
+    std::vector<char> buffer{};
+
+    void flush() {
+        if (!buffer.empty()) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            std::fflush(out);
+            buffer.clear();
+        }
+    }
+
+  public:
+    BinaryWriter(std::FILE *out, SymbolTable &symbols) : out(out), encoder(symbols) {
+    }
+
+    // The symbol is given by name or by its id in the writer's symbol table.
+    template<typename Symbol>
+    void writeQuotes(Symbol symbol, const dxf_quote_t *quotes, int count) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        encoder.encodeQuotes(symbol, quotes, count, buffer);
+        flush();
+    }
+
+    template<typename Symbol>
+    void writeTrades(Symbol symbol, const dxf_trade_t *trades, int count, const std::uint8_t *aggressorSides) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        encoder.encodeTrades(symbol, trades, count, aggressorSides, buffer);
+        flush();
+    }
+};
@@ -0,0 +1,134 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "VectorMath.hpp"
+
+// Batch Black-Scholes implied volatility and Greeks (European exercise, no dividends), vmath::Vec::WIDTH options
+// per instruction.
+namespace blackscholes {
+
+// Inputs and outputs of a batch as parallel arrays. The arrays are padded to a whole number of vectors with a
+// well-formed dummy option, so the kernel has no scalar tail.
+struct Batch {
+    std::size_t count{0};
+
+    std::vector<double> spot{};
+    std::vector<double> strike{};
+    std::vector<double> logMoneyness{};// ln(spot / strike)
+    std::vector<double> time{};        // years to expiry
+    std::vector<double> sign{};        // +1 call, -1 put
+    std::vector<double> price{};       // option premium to invert
+
+    std::vector<double> volatility{};// NaN if the premium is outside the no-arbitrage bounds
+    std::vector<double> delta{};
+    std::vector<double> gamma{};
+    std::vector<double> vega{}; // per 1 volatility point
+    std::vector<double> theta{};// per calendar day
+
+    void resize(std::size_t n) {
+        auto padded = (n + vmath::Vec::WIDTH - 1) / vmath::Vec::WIDTH * vmath::Vec::WIDTH;
+
+        count = n;
+
+        for (auto *column : {&spot, &strike, &logMoneyness, &time, &sign, &price, &volatility, &delta, &gamma, &vega,
+                             &theta}) {
+            column->resize(padded);
+        }
+
+        for (auto i = n; i < padded; i++) {
+            spot[i] = 1.0;
+            strike[i] = 1.0;
+            logMoneyness[i] = 0.0;
+            time[i] = 1.0;
+            sign[i] = 1.0;
+            price[i] = 0.1;
+        }
+    }
+};
+
+constexpr int MAX_ITERATIONS = 32;
+constexpr double PRICE_TOLERANCE = 1e-9;
+constexpr double MIN_VOLATILITY = 1e-4;
+constexpr double MAX_VOLATILITY = 5.0;
+
+// Solves the implied volatility of every option in the batch, then its Greeks at that volatility. Newton steps on
+// vega from the Manaster-Koehler start, safeguarded by a per-lane bisection bracket; the iteration stops when all
+// lanes of a vector have converged.
+inline void solve(Batch &b, double rate) {
+    using namespace vmath;
+
+    auto r = set1(rate);
+    auto zero = set1(0.0);
+    auto half = set1(0.5);
+    auto nan = set1(std::numeric_limits<double>::quiet_NaN());
+
+    for (std::size_t i = 0; i < b.count; i += Vec::WIDTH) {
+        auto s = load(&b.spot[i]);
+        auto k = load(&b.strike[i]);
+        auto x = load(&b.logMoneyness[i]);
+        auto t = load(&b.time[i]);
+        auto sign = load(&b.sign[i]);
+        auto premium = load(&b.price[i]);
+
+        auto sqrtT = sqrt(t);
+        auto discountedStrike = k * exp(zero - r * t);
+        auto intrinsic = max(sign * (s - discountedStrike), zero);
+        auto upper = select(sign > zero, s, discountedStrike);
+        auto valid = (premium > intrinsic) & (premium < upper) & (t > zero);
+
+        auto lo = set1(MIN_VOLATILITY);
+        auto hi = set1(MAX_VOLATILITY);
+        auto sigma = min(max(sqrt(abs(x + r * t) * set1(2.0) / t), set1(0.05)), set1(3.0));
+        auto d1 = zero;
+        auto d2 = zero;
+
+        for (int iteration = 0;; iteration++) {
+            auto stdDev = sigma * sqrtT;
+
+            d1 = (x + (r + half * sigma * sigma) * t) / stdDev;
+            d2 = d1 - stdDev;
+
+            if (iteration == MAX_ITERATIONS) {
+                break;
+            }
+
+            auto model = sign * (s * normalCdf(sign * d1) - discountedStrike * normalCdf(sign * d2));
+            auto diff = model - premium;
+            auto done = (abs(diff) < set1(PRICE_TOLERANCE)) | !valid;
+
+            if (all(done)) {
+                break;
+            }
+
+            hi = select(diff > zero, sigma, hi);
+            lo = select(diff < zero, sigma, lo);
+
+            // A NaN or out-of-bracket Newton step (vega ~ 0 far from the money) falls back to bisection.
+            auto newton = sigma - diff / (s * normalPdf(d1) * sqrtT);
+            auto inside = (newton > lo) & (newton < hi);
+
+            sigma = select(done, sigma, select(inside, newton, (lo + hi) * half));
+        }
+
+        auto pdf = normalPdf(d1);
+        auto delta = normalCdf(d1) + half * (sign - set1(1.0));
+        auto gamma = pdf / (s * sigma * sqrtT);
+        auto vega = s * pdf * sqrtT * set1(0.01);
+        auto theta = (zero - s * pdf * sigma * half / sqrtT - sign * r * discountedStrike * normalCdf(sign * d2)) *
+                     set1(1.0 / 365.0);
+
+        store(&b.volatility[i], select(valid, sigma, nan));
+        store(&b.delta[i], select(valid, delta, nan));
+        store(&b.gamma[i], select(valid, gamma, nan));
+        store(&b.vega[i], select(valid, vega, nan));
+        store(&b.theta[i], select(valid, theta, nan));
+    }
+}
+
+}// namespace blackscholes
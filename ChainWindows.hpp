@@ -0,0 +1,295 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <DXFeed.h>
+
+#include "OptionChains.hpp"
+#include "SymbolTable.hpp"
+#include "SymbolUniverse.hpp"
+
+// Subscribes to a window of each option chain instead of the whole chain: the options within `strikes` strikes of
+// the at-the-money strike for each of the `expiries` nearest expiries, plus the underlying. Each expiry has its own
+// sorted strike list and finds its ATM strike by binary search on the underlying mid price.
+//
+// The ATM strike moves only when the price is nearer to another strike by a quarter of the distance between the
+// two strikes, so a price oscillating around a midpoint does not churn the subscription. When a window moves, apply()
+// diffs the new symbol set against the live one and adds and removes only the difference, in batches. onQuotes() only
+// moves the windows and signals waitForMove(), so the subscription calls run on the caller's own thread.
+class ChainWindows {
+    static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+    struct Expiry {
+        std::int64_t time{0};// ms since epoch
+        std::vector<double> strikes{};
+        std::vector<std::uint32_t> calls{};// by strike index, INVALID_ID if not listed
+        std::vector<std::uint32_t> puts{};
+        std::size_t atm{NONE};
+    };
+
+    struct Chain {
+        std::uint32_t underlyingId{SymbolTable::INVALID_ID};
+        double spot{std::numeric_limits<double>::quiet_NaN()};
+        std::vector<Expiry> expiries{};// by time
+        std::size_t firstLive{0};      // the first expiry not yet expired, as of the last move
+    };
+
+    SymbolTable &symbols;
+    std::size_t strikes;
+    std::size_t expiries;
+    std::mutex mutex{};
+    std::vector<Chain> chains{};
+    std::vector<std::int32_t> chainOf{};// underlying symbol id -> chain index
+    std::size_t optionCount{0};
+    std::condition_variable movedSignal{};
+    bool moved{false};
+
+    std::mutex universeMutex{};
+    SymbolUniverse universe;
+
+    static std::int64_t nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static std::size_t nearest(const std::vector<double> &sorted, double price) {
+        auto i = static_cast<std::size_t>(std::lower_bound(sorted.begin(), sorted.end(), price) - sorted.begin());
+
+        if (i == sorted.size()) {
+            return i - 1;
+        }
+
+        return i > 0 && price - sorted[i - 1] < sorted[i] - price ? i - 1 : i;
+    }
+
+    static std::size_t atmOf(const Expiry &e, double spot) {
+        auto n = nearest(e.strikes, spot);
+
+        if (e.atm == NONE || n == e.atm) {
+            return n;
+        }
+
+        auto current = std::abs(spot - e.strikes[e.atm]);
+        auto candidate = std::abs(spot - e.strikes[n]);
+
+        return candidate + 0.25 * std::abs(e.strikes[n] - e.strikes[e.atm]) < current ? n : e.atm;
+    }
+
+    Chain &chainFor(std::uint32_t underlyingId) {
+        if (underlyingId >= chainOf.size()) {
+            chainOf.resize(underlyingId + 1, -1);
+        }
+
+        if (chainOf[underlyingId] < 0) {
+            chainOf[underlyingId] = static_cast<std::int32_t>(chains.size());
+            chains.emplace_back();
+            chains.back().underlyingId = underlyingId;
+        }
+
+        return chains[chainOf[underlyingId]];
+    }
+
+    // The symbol ids of the current windows and the underlyings. Called with the lock held.
+    void collect(std::vector<std::wstring> &out) {
+        for (auto &c : chains) {
+            out.push_back(symbols.name(c.underlyingId));
+
+            for (auto e = c.firstLive; e < std::min(c.expiries.size(), c.firstLive + expiries); e++) {
+                auto &x = c.expiries[e];
+
+                if (x.atm == NONE) {
+                    continue;
+                }
+
+                auto from = x.atm >= strikes ? x.atm - strikes : 0;
+                auto to = std::min(x.strikes.size(), x.atm + strikes + 1);
+
+                for (auto k = from; k < to; k++) {
+                    for (auto id : {x.calls[k], x.puts[k]}) {
+                        if (id != SymbolTable::INVALID_ID) {
+                            out.push_back(symbols.name(id));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+  public:
+    ChainWindows(SymbolTable &symbols, std::size_t strikes, std::size_t expiries, std::size_t batchSize = 512)
+        : symbols(symbols), strikes(strikes), expiries(std::max<std::size_t>(expiries, 1)),
+          universe(symbols, batchSize) {
+    }
+
+    // Adds an option of a tracked underlying. Returns false if the symbol is not an option symbol.
+    bool addOption(const std::wstring &symbol) {
+        OptionContract contract{};
+
+        if (!parseOptionSymbol(symbol, contract)) {
+            return false;
+        }
+
+        auto optionId = symbols.intern(symbol).first;
+        auto underlyingId = symbols.intern(contract.underlying).first;
+        std::lock_guard<std::mutex> lock{mutex};
+        auto &c = chainFor(underlyingId);
+        auto e = std::lower_bound(c.expiries.begin(), c.expiries.end(), contract.expiry,
+                                  [](const Expiry &x, std::int64_t time) {
+                                      return x.time < time;
+                                  });
+
+        if (e == c.expiries.end() || e->time != contract.expiry) {
+            e = c.expiries.insert(e, Expiry{});
+            e->time = contract.expiry;
+        }
+
+        auto at = std::lower_bound(e->strikes.begin(), e->strikes.end(), contract.strike) - e->strikes.begin();
+
+        if (at == static_cast<std::ptrdiff_t>(e->strikes.size()) || e->strikes[at] != contract.strike) {
+            e->strikes.insert(e->strikes.begin() + at, contract.strike);
+            e->calls.insert(e->calls.begin() + at, std::uint32_t{SymbolTable::INVALID_ID});
+            e->puts.insert(e->puts.begin() + at, std::uint32_t{SymbolTable::INVALID_ID});
+        }
+
+        (contract.call ? e->calls : e->puts)[at] = optionId;
+        optionCount++;
+
+        return true;
+    }
+
+    std::size_t size() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        return optionCount;
+    }
+
+    // Tracks the underlying price; returns true if a window has moved and apply() should be called.
+    // Quotes of symbols other than tracked underlyings are ignored.
+    bool onQuotes(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count) {
+        return onQuotes(symbols.find(symbolName), quotes, count);
+    }
+
+    // `symbolId` is an id of the windows' symbol table.
+    bool onQuotes(std::uint32_t symbolId, const dxf_quote_t *quotes, int count) {
+        if (count <= 0) {
+            return false;
+        }
+
+        auto &q = quotes[count - 1];
+
+        if (!(q.bid_price > 0.0 && q.ask_price > 0.0)) {
+            return false;
+        }
+
+        auto spot = (q.bid_price + q.ask_price) / 2.0;
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId >= chainOf.size() || chainOf[symbolId] < 0) {
+            return false;
+        }
+
+        auto &c = chains[chainOf[symbolId]];
+
+        if (spot == c.spot) {
+            return false;
+        }
+
+        auto now = nowMillis();
+        auto firstLive = c.firstLive;
+
+        while (firstLive < c.expiries.size() && c.expiries[firstLive].time <= now) {
+            firstLive++;
+        }
+
+        bool windowMoved = firstLive != c.firstLive;
+
+        c.firstLive = firstLive;
+        c.spot = spot;
+
+        for (auto e = firstLive; e < std::min(c.expiries.size(), firstLive + expiries); e++) {
+            auto &x = c.expiries[e];
+            auto atm = atmOf(x, spot);
+
+            windowMoved = windowMoved || atm != x.atm;
+            x.atm = atm;
+        }
+
+        if (windowMoved) {
+            moved = true;
+            movedSignal.notify_one();
+        }
+
+        return windowMoved;
+    }
+
+    // Waits up to `timeout` for a window to move since the last call; returns true if one has.
+    bool waitForMove(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        movedSignal.wait_for(lock, timeout, [this] {
+            return moved;
+        });
+
+        auto result = moved;
+
+        moved = false;
+
+        return result;
+    }
+
+    // Moves the subscription to the current windows: `add` and `remove` receive batches of symbols.
+    SymbolDiff apply(const SymbolUniverse::Apply &add, const SymbolUniverse::Apply &remove) {
+        std::vector<std::wstring> desired{};
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            collect(desired);
+        }
+
+        std::lock_guard<std::mutex> lock{universeMutex};
+
+        return universe.reconcile(desired, add, remove);
+    }
+
+    // One line per chain: spot and the ATM strike of each window expiry (by days to expiry).
+    std::string toText() {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::string text{};
+        auto now = nowMillis();
+
+        for (auto &c : chains) {
+            auto name = symbols.name(c.underlyingId);
+
+            text += fmt::format("Window {} spot = {:.4f}:", std::string(name.begin(), name.end()), c.spot);
+
+            for (auto e = c.firstLive; e < std::min(c.expiries.size(), c.firstLive + expiries); e++) {
+                auto &x = c.expiries[e];
+                auto days = (x.time - now) / 86400000;
+
+                text += x.atm == NONE ? fmt::format(" {}d -", days)
+                                      : fmt::format(" {}d ATM {}", days, x.strikes[x.atm]);
+            }
+
+            text += "\n";
+        }
+
+        std::lock_guard<std::mutex> universeLock{universeMutex};
+
+        return text + fmt::format("Windows: {} symbols subscribed of {} options\n", universe.size(), optionCount);
+    }
+};
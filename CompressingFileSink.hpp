@@ -0,0 +1,128 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FileSink.hpp"
+#include "LzCodec.hpp"
+
+// Compresses data into independent LZ blocks on its own thread and passes the framed blocks to another sink.
+// The producer only copies into the current block; it waits only if `maxQueuedBlocks` blocks are already pending.
+class CompressingFileSink : public FileSink {
+    struct Block {
+        std::vector<char> data{};
+        bool flushAfter{false};
+    };
+
+    std::unique_ptr<FileSink> inner;
+    std::size_t blockSize;
+    std::size_t maxQueuedBlocks;
+    std::mutex mutex{};
+    std::condition_variable workerWakeup{};
+    std::condition_variable producerWakeup{};
+    std::vector<char> current{};
+    std::deque<Block> queue{};
+    bool stopping{false};
+    std::thread worker{};
+
+    void enqueue(bool flushAfter, std::unique_lock<std::mutex> &lock) {
+        producerWakeup.wait(lock, [this] {
+            return queue.size() < maxQueuedBlocks;
+        });
+
+        Block block{};
+
+        block.data.reserve(blockSize);
+        block.data.swap(current);
+        block.flushAfter = flushAfter;
+        queue.push_back(std::move(block));
+        workerWakeup.notify_one();
+    }
+
+    void run() {
+        std::vector<char> compressed{};
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (true) {
+            workerWakeup.wait(lock, [this] {
+                return !queue.empty() || stopping;
+            });
+
+            if (queue.empty()) {
+                return;
+            }
+
+            auto block = std::move(queue.front());
+
+            queue.pop_front();
+            producerWakeup.notify_one();
+            lock.unlock();
+
+            if (!block.data.empty()) {
+                compressed.clear();
+                lz::compressBlock(block.data.data(), block.data.size(), compressed);
+                SUPDXFD_PROBE2(sink__flush, "lz", compressed.size());
+                inner->write(compressed.data(), compressed.size());
+            }
+
+            if (block.flushAfter) {
+                inner->flush();
+            }
+
+            lock.lock();
+        }
+    }
+
+  public:
+    CompressingFileSink(std::unique_ptr<FileSink> inner, std::size_t blockSize = 256 << 10,
+                        std::size_t maxQueuedBlocks = 8)
+        : inner(std::move(inner)), blockSize(blockSize), maxQueuedBlocks(maxQueuedBlocks) {
+        current.reserve(blockSize);
+        worker = std::thread(&CompressingFileSink::run, this);
+    }
+
+    void write(const char *data, std::size_t size) override {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (size != 0) {
+            auto chunk = std::min(size, blockSize - current.size());
+
+            current.insert(current.end(), data, data + chunk);
+            data += chunk;
+            size -= chunk;
+
+            if (current.size() == blockSize) {
+                enqueue(false, lock);
+            }
+        }
+    }
+
+    void flush() override {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        enqueue(true, lock);
+    }
+
+    ~CompressingFileSink() override {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+
+            if (!current.empty()) {
+                enqueue(false, lock);
+            }
+
+            stopping = true;
+            workerWakeup.notify_one();
+        }
+
+        worker.join();
+    }
+};
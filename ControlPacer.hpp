@@ -0,0 +1,227 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <DXFeed.h>
+
+// Paces the control calls of one connection (creating and closing subscriptions, adding and removing symbols)
+// through a token bucket, so that a burst such as a universe reload reaches the C API and the upstream at a bounded
+// rate instead of contending with the data path all at once. call() blocks until its call has been made;
+// changeSymbols() only queues the request and returns a future of its result, so that a caller can queue all the
+// batches of a change before waiting for them.
+//
+// Calls run on the pacer's thread in arrival order, one token each. While a call waits for a token, symbol requests
+// keep queueing; consecutive requests that add (or remove) symbols of the same subscription are then merged into one
+// call. A failed call is reported by `onFailure` on the pacer's thread, where the C API's last error is kept.
+class ControlPacer {
+  public:
+    using Call = std::function<ERRORCODE()>;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        Call call{};                         // any call, or
+        dxf_subscription_t handle{nullptr};  // a symbol request of this subscription
+        bool add{false};
+        std::vector<std::wstring> symbols{};
+        Clock::time_point queued{};
+        std::promise<bool> done{};
+    };
+
+    double rate;
+    double burst;
+    double tokens;
+    Clock::time_point refilled{Clock::now()};
+    std::function<void()> onFailure;
+
+    std::mutex mutex{};
+    std::condition_variable wakeup{};
+    std::deque<std::unique_ptr<Request>> queue{};
+    bool stopping{false};
+    std::thread thread{};
+
+    std::uint64_t requests{0};
+    std::uint64_t calls{0};
+    std::uint64_t failures{0};
+    Clock::duration totalDelay{0};
+    Clock::duration maxDelay{0};
+
+    void takeToken() {
+        while (true) {
+            auto now = Clock::now();
+
+            tokens = std::min(burst, tokens + std::chrono::duration<double>(now - refilled).count() * rate);
+            refilled = now;
+
+            if (tokens >= 1.0) {
+                tokens -= 1.0;
+
+                return;
+            }
+
+            std::this_thread::sleep_for(std::chrono::duration<double>((1.0 - tokens) / rate));
+        }
+    }
+
+    static ERRORCODE applySymbols(dxf_subscription_t handle, bool add, const std::vector<std::wstring> &symbols) {
+        std::vector<dxf_const_string_t> names{};
+
+        names.reserve(symbols.size());
+
+        for (auto &s : symbols) {
+            names.push_back(s.c_str());
+        }
+
+        return add ? dxf_add_symbols(handle, names.data(), static_cast<int>(names.size()))
+                   : dxf_remove_symbols(handle, names.data(), static_cast<int>(names.size()));
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (true) {
+            wakeup.wait(lock, [this] {
+                return !queue.empty() || stopping;
+            });
+
+            if (queue.empty()) {
+                return;
+            }
+
+            lock.unlock();
+            takeToken();
+            lock.lock();
+
+            std::vector<std::unique_ptr<Request>> batch{};
+            auto started = Clock::now();
+
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+
+            auto &first = *batch.front();
+
+            while (!first.call && !queue.empty() && !queue.front()->call && queue.front()->handle == first.handle &&
+                   queue.front()->add == first.add) {
+                first.symbols.insert(first.symbols.end(), queue.front()->symbols.begin(),
+                                     queue.front()->symbols.end());
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+
+            for (auto &r : batch) {
+                auto delay = started - r->queued;
+
+                totalDelay += delay;
+                maxDelay = std::max(maxDelay, delay);
+            }
+
+            requests += batch.size();
+            calls++;
+            lock.unlock();
+
+            auto result = first.call ? first.call() : applySymbols(first.handle, first.add, first.symbols);
+            auto ok = result != DXF_FAILURE;
+
+            if (!ok && onFailure) {
+                onFailure();
+            }
+
+            for (auto &r : batch) {
+                r->done.set_value(ok);
+            }
+
+            lock.lock();
+            failures += ok ? 0 : 1;
+        }
+    }
+
+    std::future<bool> enqueue(std::unique_ptr<Request> request) {
+        auto done = request->done.get_future();
+
+        request->queued = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (stopping) {
+                request->done.set_value(false);
+
+                return done;
+            }
+
+            queue.push_back(std::move(request));
+        }
+
+        wakeup.notify_one();
+
+        return done;
+    }
+
+  public:
+    // At most `rate` calls per second on average and `burst` calls at once.
+    ControlPacer(double rate, double burst, std::function<void()> onFailure)
+        : rate(std::max(rate, 0.001)), burst(std::max(burst, 1.0)), tokens(this->burst),
+          onFailure(std::move(onFailure)) {
+        thread = std::thread(&ControlPacer::run, this);
+    }
+
+    ~ControlPacer() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            stopping = true;
+        }
+
+        wakeup.notify_one();
+        thread.join();
+    }
+
+    // Makes a control call in its turn; returns false if it failed.
+    bool call(Call call) {
+        std::unique_ptr<Request> request{new Request{}};
+
+        request->call = std::move(call);
+
+        return enqueue(std::move(request)).get();
+    }
+
+    // Queues adding or removing symbols of a subscription; the call is made in its turn, possibly together with other
+    // queued requests. The future tells whether it succeeded.
+    std::future<bool> changeSymbols(dxf_subscription_t handle, bool add, std::vector<std::wstring> symbols) {
+        std::unique_ptr<Request> request{new Request{}};
+
+        request->handle = handle;
+        request->add = add;
+        request->symbols = std::move(symbols);
+
+        return enqueue(std::move(request));
+    }
+
+    // "120 requests in 35 calls (1 failed), queueing delay avg 210.0 ms, max 1200.0 ms"
+    std::string toText() {
+        std::lock_guard<std::mutex> lock{mutex};
+        using Millis = std::chrono::duration<double, std::milli>;
+
+        return fmt::format("{} requests in {} calls ({} failed), queueing delay avg {:.1f} ms, max {:.1f} ms",
+                           requests, calls, failures,
+                           requests == 0 ? 0.0 : std::chrono::duration_cast<Millis>(totalDelay).count() / requests,
+                           std::chrono::duration_cast<Millis>(maxDelay).count());
+    }
+};
@@ -0,0 +1,328 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#if defined(__linux__)
+#    define SUPDXFD_HAVE_CONTROL_SOCKET 1
+#endif
+
+#ifdef SUPDXFD_HAVE_CONTROL_SOCKET
+
+#    include <cerrno>
+#    include <cstdint>
+#    include <cstdio>
+#    include <cstring>
+#    include <functional>
+#    include <memory>
+#    include <string>
+#    include <thread>
+#    include <unordered_map>
+
+#    include <fcntl.h>
+#    include <sys/epoll.h>
+#    include <sys/eventfd.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+
+// A Unix-domain control socket served by one epoll thread. Clients send newline-terminated commands; each command is
+// passed to the handler and its reply is written back. All sockets are non-blocking, so a client that stops reading
+// only holds its own reply buffer, and the handler runs on the control thread, never on a listener or lane thread.
+class ControlServer {
+  public:
+    using Handler = std::function<std::string(const std::string &command)>;
+
+  private:
+    static constexpr std::size_t MAX_COMMAND = 1 << 16;
+
+    struct Client {
+        std::string in{};
+        std::string out{};
+        bool halfClosed{false};// the client has shut down its side; it is kept until `out` is sent
+    };
+
+    std::string path;
+    Handler handler;
+    int listenFd{-1};
+    int epollFd{-1};
+    int wakeFd{-1};
+    bool bound{false};// `path` was created by this server
+    std::unordered_map<int, Client> clients{};
+    std::thread thread{};
+
+    ControlServer(std::string path, Handler handler) : path(std::move(path)), handler(std::move(handler)) {
+    }
+
+    bool watch(int fd, std::uint32_t events, int op) {
+        epoll_event event{};
+
+        event.events = events;
+        event.data.fd = fd;
+
+        return epoll_ctl(epollFd, op, fd, &event) == 0;
+    }
+
+    void drop(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        clients.erase(fd);
+    }
+
+    void acceptClients() {
+        while (true) {
+            auto fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+            if (fd < 0) {
+                return;
+            }
+
+            if (!watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD)) {
+                close(fd);
+
+                continue;
+            }
+
+            clients[fd] = Client{};
+        }
+    }
+
+    // Writes as much of the pending reply as the socket takes; returns false if the client is gone, or has half-closed
+    // the connection and been sent everything. A half-closed client is only watched for writability.
+    bool flush(int fd, Client &client) {
+        while (!client.out.empty()) {
+            auto n = send(fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+
+                return false;
+            }
+
+            client.out.erase(0, static_cast<std::size_t>(n));
+        }
+
+        if (client.halfClosed) {
+            return !client.out.empty() && watch(fd, EPOLLOUT, EPOLL_CTL_MOD);
+        }
+
+        return watch(fd, client.out.empty() ? EPOLLIN | EPOLLRDHUP : EPOLLIN | EPOLLRDHUP | EPOLLOUT, EPOLL_CTL_MOD);
+    }
+
+    // Reads what is available and runs every complete command; returns false if the client is gone.
+    bool readCommands(int fd, Client &client) {
+        char buffer[4096];
+
+        while (true) {
+            auto n = recv(fd, buffer, sizeof(buffer), 0);
+
+            if (n > 0) {
+                client.in.append(buffer, static_cast<std::size_t>(n));
+
+                continue;
+            }
+
+            client.halfClosed = !(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+
+            break;
+        }
+
+        std::size_t from = 0;
+
+        for (auto eol = client.in.find('\n'); eol != std::string::npos; eol = client.in.find('\n', from)) {
+            auto command = client.in.substr(from, eol - from);
+
+            if (!command.empty() && command.back() == '\r') {
+                command.pop_back();
+            }
+
+            if (!command.empty()) {
+                client.out += handler(command);
+            }
+
+            from = eol + 1;
+        }
+
+        client.in.erase(0, from);
+
+        if (client.in.size() > MAX_COMMAND) {
+            return false;
+        }
+
+        return flush(fd, client);
+    }
+
+    void run() {
+        epoll_event events[64];
+
+        while (true) {
+            auto n = epoll_wait(epollFd, events, 64, -1);
+
+            if (n < 0 && errno != EINTR) {
+                return;
+            }
+
+            for (int i = 0; i < n; i++) {
+                auto fd = events[i].data.fd;
+
+                if (fd == wakeFd) {
+                    return;
+                }
+
+                if (fd == listenFd) {
+                    acceptClients();
+
+                    continue;
+                }
+
+                auto found = clients.find(fd);
+
+                if (found == clients.end()) {
+                    continue;
+                }
+
+                auto &client = found->second;
+                auto readable = (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) != 0;
+                auto alive = readable && !client.halfClosed ? readCommands(fd, client) : flush(fd, client);
+
+                if (!alive || (events[i].events & EPOLLERR)) {
+                    drop(fd);
+                }
+            }
+        }
+    }
+
+    // Removes a socket file left at `path` by a server that is gone: nothing else is deleted, and a socket that still
+    // accepts connections belongs to a running instance. Returns false and sets `error` if `path` cannot be used.
+    static bool removeStaleSocket(const std::string &path, const sockaddr_un &address, std::string &error) {
+        struct stat st {};
+
+        if (lstat(path.c_str(), &st) != 0) {
+            if (errno == ENOENT) {
+                return true;
+            }
+
+            error = "Cannot check " + path + ": " + std::strerror(errno);
+
+            return false;
+        }
+
+        if (!S_ISSOCK(st.st_mode)) {
+            error = "Cannot listen on " + path + ": the file exists and is not a socket";
+
+            return false;
+        }
+
+        auto probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        if (probe < 0) {
+            error = std::string("Cannot create the control socket: ") + std::strerror(errno);
+
+            return false;
+        }
+
+        auto connected = connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+        auto connectError = errno;
+
+        close(probe);
+
+        if (connected || connectError != ECONNREFUSED) {
+            error = "Cannot listen on " + path + ": " +
+                    (connected ? std::string("another instance is listening on it") : std::strerror(connectError));
+
+            return false;
+        }
+
+        unlink(path.c_str());
+
+        return true;
+    }
+
+  public:
+    // Binds the socket, replacing a stale socket file at `path`. Returns null and sets `error` on failure.
+    static std::unique_ptr<ControlServer> open(const std::string &path, Handler handler, std::string &error) {
+        std::unique_ptr<ControlServer> server{new ControlServer(path, std::move(handler))};
+        sockaddr_un address{};
+
+        if (path.size() >= sizeof(address.sun_path)) {
+            error = "Control socket path is too long: " + path;
+
+            return nullptr;
+        }
+
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        server->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        server->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        server->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        if (server->listenFd < 0 || server->epollFd < 0 || server->wakeFd < 0) {
+            error = std::string("Cannot create the control socket: ") + std::strerror(errno);
+
+            return nullptr;
+        }
+
+        if (!removeStaleSocket(path, address, error)) {
+            return nullptr;
+        }
+
+        server->bound = bind(server->listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+
+        if (!server->bound || listen(server->listenFd, 16) != 0) {
+            error = "Cannot listen on " + path + ": " + std::strerror(errno);
+
+            return nullptr;
+        }
+
+        if (!server->watch(server->listenFd, EPOLLIN, EPOLL_CTL_ADD) ||
+            !server->watch(server->wakeFd, EPOLLIN, EPOLL_CTL_ADD)) {
+            error = std::string("Cannot watch the control socket: ") + std::strerror(errno);
+
+            return nullptr;
+        }
+
+        return server;
+    }
+
+    void start() {
+        thread = std::thread(&ControlServer::run, this);
+    }
+
+    // Stops the loop and disconnects the clients; a command being handled is finished first.
+    void stop() {
+        if (!thread.joinable()) {
+            return;
+        }
+
+        std::uint64_t one = 1;
+
+        if (write(wakeFd, &one, sizeof(one)) != sizeof(one)) {
+            std::fprintf(stderr, "Cannot wake the control thread: %s\n", std::strerror(errno));
+        }
+
+        thread.join();
+    }
+
+    ~ControlServer() {
+        stop();
+
+        for (auto &c : clients) {
+            close(c.first);
+        }
+
+        for (auto fd : {listenFd, epollFd, wakeFd}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        if (bound) {
+            unlink(path.c_str());
+        }
+    }
+};
+
+#endif// SUPDXFD_HAVE_CONTROL_SOCKET
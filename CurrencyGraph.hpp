@@ -0,0 +1,327 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <DXFeed.h>
+
+#include "SymbolTable.hpp"
+
+// Splits a currency pair symbol "BASE/QUOTE" (optionally followed by ":<exchange>", e.g. "BTC/USD:CXBITF").
+inline bool parseCurrencyPair(const std::wstring &symbol, std::wstring &base, std::wstring &quote) {
+    auto end = symbol.find(L':');
+    auto slash = symbol.find(L'/');
+
+    if (end == std::wstring::npos) {
+        end = symbol.size();
+    }
+
+    if (slash == std::wstring::npos || slash == 0 || slash + 1 >= end) {
+        return false;
+    }
+
+    base = symbol.substr(0, slash);
+    quote = symbol.substr(slash + 1, end - slash - 1);
+
+    return base != quote;
+}
+
+// A triangular cycle and its arbitrage spreads as of the last update of any of its legs.
+struct TriangleSpread {
+    std::string cycle{};// "A -> B -> C -> A" in the direction of the better spread
+    double spread{0.0}; // product of the conversion rates around the cycle minus 1
+};
+
+// Best implied rate of a pair through any third currency, next to the direct quote.
+struct CrossRate {
+    std::string pair{};
+    double bid{0.0};
+    double ask{0.0};
+    double impliedBid{0.0};
+    double impliedAsk{0.0};
+};
+
+// Currencies as nodes, pair quotes as edges. Converting `base` to `quote` pays the bid, `quote` to `base` pays
+// 1 / ask. Every triangle of currencies whose three pairs are known is found once, when its last pair is added, and
+// linked from its pairs, so a quote only re-evaluates the triangles containing its pair.
+class CurrencyGraph {
+    struct Pair {
+        std::uint32_t symbolId{SymbolTable::INVALID_ID};
+        std::uint32_t base{0};
+        std::uint32_t quote{0};
+        double bid{std::numeric_limits<double>::quiet_NaN()};
+        double ask{std::numeric_limits<double>::quiet_NaN()};
+        std::vector<std::uint32_t> triangles{};
+    };
+
+    struct Triangle {
+        std::uint32_t currencies[3];// a, b, c
+        std::uint32_t pairs[3];     // a-b, b-c, c-a
+        double forward{std::numeric_limits<double>::quiet_NaN()}; // a -> b -> c -> a
+        double backward{std::numeric_limits<double>::quiet_NaN()};// a -> c -> b -> a
+    };
+
+    SymbolTable &symbols;
+    std::mutex mutex{};
+    std::vector<std::wstring> currencies{};
+    std::unordered_map<std::wstring, std::uint32_t> currencyIds{};
+    std::vector<std::unordered_map<std::uint32_t, std::uint32_t>> adjacency{};// currency -> neighbour -> pair
+    std::vector<Pair> pairs{};
+    std::vector<std::int32_t> pairBySymbol{};
+    std::vector<Triangle> triangles{};
+
+    std::uint32_t currency(const std::wstring &name) {
+        auto found = currencyIds.find(name);
+
+        if (found != currencyIds.end()) {
+            return found->second;
+        }
+
+        auto id = static_cast<std::uint32_t>(currencies.size());
+
+        currencyIds.emplace(name, id);
+        currencies.push_back(name);
+        adjacency.emplace_back();
+
+        return id;
+    }
+
+    std::string currencyName(std::uint32_t id) const {
+        return std::string(currencies[id].begin(), currencies[id].end());
+    }
+
+    // Amount of `to` received for one unit of `from` over the pair.
+    double rate(std::uint32_t pairIndex, std::uint32_t from) const {
+        auto &p = pairs[pairIndex];
+
+        return p.base == from ? p.bid : 1.0 / p.ask;
+    }
+
+    void evaluate(Triangle &t) {
+        auto a = t.currencies[0];
+        auto b = t.currencies[1];
+        auto c = t.currencies[2];
+
+        t.forward = rate(t.pairs[0], a) * rate(t.pairs[1], b) * rate(t.pairs[2], c) - 1.0;
+        t.backward = rate(t.pairs[2], a) * rate(t.pairs[1], c) * rate(t.pairs[0], b) - 1.0;
+    }
+
+  public:
+    explicit CurrencyGraph(SymbolTable &symbols) : symbols(symbols) {
+    }
+
+    // Adds a pair symbol. Returns false if it is not a currency pair.
+    bool addPair(const std::wstring &symbol) {
+        std::wstring baseName{};
+        std::wstring quoteName{};
+
+        if (!parseCurrencyPair(symbol, baseName, quoteName)) {
+            return false;
+        }
+
+        auto symbolId = symbols.intern(symbol).first;
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId >= pairBySymbol.size()) {
+            pairBySymbol.resize(symbolId + 1, -1);
+        }
+
+        auto base = currency(baseName);
+        auto quote = currency(quoteName);
+
+        // One edge per currency pair; a second venue for the same pair is not a separate edge.
+        if (pairBySymbol[symbolId] >= 0 || adjacency[base].count(quote) != 0) {
+            return true;
+        }
+
+        auto pairIndex = static_cast<std::uint32_t>(pairs.size());
+
+        pairs.emplace_back();
+        pairs.back().symbolId = symbolId;
+        pairs.back().base = base;
+        pairs.back().quote = quote;
+        pairBySymbol[symbolId] = static_cast<std::int32_t>(pairIndex);
+
+        // New triangles are exactly the common neighbours of the two currencies.
+        auto &smaller = adjacency[base].size() <= adjacency[quote].size() ? adjacency[base] : adjacency[quote];
+        auto &larger = &smaller == &adjacency[base] ? adjacency[quote] : adjacency[base];
+
+        for (auto &neighbour : smaller) {
+            auto other = larger.find(neighbour.first);
+
+            if (other == larger.end()) {
+                continue;
+            }
+
+            auto c = neighbour.first;
+            Triangle t{{base, quote, c}, {pairIndex, adjacency[quote].at(c), adjacency[c].at(base)}};
+            auto triangleIndex = static_cast<std::uint32_t>(triangles.size());
+
+            triangles.push_back(t);
+
+            for (auto p : t.pairs) {
+                pairs[p].triangles.push_back(triangleIndex);
+            }
+        }
+
+        adjacency[base][quote] = pairIndex;
+        adjacency[quote][base] = pairIndex;
+
+        return true;
+    }
+
+    std::vector<std::wstring> subscriptionSymbols() {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::vector<std::wstring> result{};
+
+        for (auto &p : pairs) {
+            result.push_back(symbols.name(p.symbolId));
+        }
+
+        return result;
+    }
+
+    std::size_t triangleCount() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        return triangles.size();
+    }
+
+    void onQuotes(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count) {
+        onQuotes(symbols.find(symbolName), quotes, count);
+    }
+
+    // `symbolId` is an id of the graph's symbol table.
+    void onQuotes(std::uint32_t symbolId, const dxf_quote_t *quotes, int count) {
+        if (count <= 0) {
+            return;
+        }
+
+        auto &q = quotes[count - 1];
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId >= pairBySymbol.size() || pairBySymbol[symbolId] < 0) {
+            return;
+        }
+
+        auto &p = pairs[pairBySymbol[symbolId]];
+        auto nan = std::numeric_limits<double>::quiet_NaN();
+        auto bid = q.bid_price > 0.0 ? q.bid_price : nan;
+        auto ask = q.ask_price > 0.0 ? q.ask_price : nan;
+
+        if ((bid == p.bid || (bid != bid && p.bid != p.bid)) && (ask == p.ask || (ask != ask && p.ask != p.ask))) {
+            return;
+        }
+
+        p.bid = bid;
+        p.ask = ask;
+
+        for (auto t : p.triangles) {
+            evaluate(triangles[t]);
+        }
+    }
+
+    // The `limit` triangles with the largest spread, in either direction.
+    std::vector<TriangleSpread> topSpreads(std::size_t limit) {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::vector<std::pair<double, std::uint32_t>> ranked{};
+
+        for (std::uint32_t i = 0; i < triangles.size(); i++) {
+            auto best = std::max(triangles[i].forward, triangles[i].backward);
+
+            if (best == best) {
+                ranked.emplace_back(best, i);
+            }
+        }
+
+        limit = std::min(limit, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(limit), ranked.end(),
+                          [](const std::pair<double, std::uint32_t> &x, const std::pair<double, std::uint32_t> &y) {
+                              return x.first > y.first;
+                          });
+
+        std::vector<TriangleSpread> result{};
+
+        for (std::size_t i = 0; i < limit; i++) {
+            auto &t = triangles[ranked[i].second];
+            auto forward = t.forward >= t.backward;
+            auto a = currencyName(t.currencies[0]);
+            auto b = currencyName(t.currencies[forward ? 1 : 2]);
+            auto c = currencyName(t.currencies[forward ? 2 : 1]);
+
+            result.push_back(TriangleSpread{fmt::format("{} -> {} -> {} -> {}", a, b, c, a), ranked[i].first});
+        }
+
+        return result;
+    }
+
+    // Direct and best implied quotes of every pair that is a leg of at least one triangle.
+    std::vector<CrossRate> crossRates() {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::vector<CrossRate> result{};
+
+        for (std::uint32_t i = 0; i < pairs.size(); i++) {
+            auto &p = pairs[i];
+
+            if (p.triangles.empty()) {
+                continue;
+            }
+
+            CrossRate cross{currencyName(p.base) + "/" + currencyName(p.quote), p.bid, p.ask,
+                            std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()};
+
+            for (auto ti : p.triangles) {
+                auto &t = triangles[ti];
+                std::uint32_t via = 0;
+
+                for (auto c : t.currencies) {
+                    if (c != p.base && c != p.quote) {
+                        via = c;
+                    }
+                }
+
+                auto toVia = adjacency[p.base].at(via);
+                auto fromVia = adjacency[via].at(p.quote);
+                auto bid = rate(toVia, p.base) * rate(fromVia, via);
+                auto ask = 1.0 / (rate(fromVia, p.quote) * rate(toVia, via));
+
+                if (bid == bid && !(bid <= cross.impliedBid)) {
+                    cross.impliedBid = bid;
+                }
+
+                if (ask == ask && !(ask >= cross.impliedAsk)) {
+                    cross.impliedAsk = ask;
+                }
+            }
+
+            result.push_back(cross);
+        }
+
+        return result;
+    }
+
+    std::string toText() {
+        std::string text{};
+
+        for (auto &c : crossRates()) {
+            text += fmt::format("Cross {} bid = {:g}, ask = {:g}, implied bid = {:g}, implied ask = {:g}\n", c.pair,
+                                c.bid, c.ask, c.impliedBid, c.impliedAsk);
+        }
+
+        for (auto &s : topSpreads(10)) {
+            text += fmt::format("Triangle {} spread = {:+.2f} bp\n", s.cycle, s.spread * 1e4);
+        }
+
+        return text;
+    }
+};
@@ -0,0 +1,227 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#ifndef _WIN32
+#    include <sys/ioctl.h>
+#    include <unistd.h>
+#endif
+
+#include "TopOfBook.hpp"
+
+// Character grid mirroring what is on the terminal. Frames are composed into the back buffer and only the cells that
+// differ from the front buffer are emitted, so the output per frame is bounded by the screen size.
+class TerminalScreen {
+    int rows{0};
+    int cols{0};
+    std::vector<char> front{};
+    std::vector<char> back{};
+
+  public:
+    void resize(int newRows, int newCols) {
+        rows = newRows;
+        cols = newCols;
+        // The caller clears the terminal after a resize, so the front buffer starts blank.
+        front.assign(static_cast<std::size_t>(rows * cols), ' ');
+        back.assign(static_cast<std::size_t>(rows * cols), ' ');
+    }
+
+    int height() const {
+        return rows;
+    }
+
+    int width() const {
+        return cols;
+    }
+
+    void clear() {
+        std::fill(back.begin(), back.end(), ' ');
+    }
+
+    void put(int row, int col, const std::string &text) {
+        if (row < 0 || row >= rows) {
+            return;
+        }
+
+        for (std::size_t i = 0; i < text.size() && col + static_cast<int>(i) < cols; i++) {
+            back[static_cast<std::size_t>(row * cols + col) + i] = text[i];
+        }
+    }
+
+    // Appends escape sequences that bring the terminal from the front to the back buffer, then swaps them.
+    void diff(std::string &out) {
+        // A cursor move costs ~8 bytes; unchanged gaps shorter than that are rewritten instead of jumped over.
+        constexpr int maxGap = 8;
+
+        for (int r = 0; r < rows; r++) {
+            auto *f = &front[static_cast<std::size_t>(r * cols)];
+            auto *b = &back[static_cast<std::size_t>(r * cols)];
+            int c = 0;
+
+            while (c < cols) {
+                if (f[c] == b[c]) {
+                    c++;
+
+                    continue;
+                }
+
+                int start = c;
+                int end = c + 1;
+                int gap = 0;
+
+                for (int i = end; i < cols && gap <= maxGap; i++) {
+                    if (f[i] != b[i]) {
+                        end = i + 1;
+                        gap = 0;
+                    } else {
+                        gap++;
+                    }
+                }
+
+                out += fmt::format("\x1b[{};{}H", r + 1, start + 1);
+                out.append(b + start, b + end);
+                c = end;
+            }
+        }
+
+        front = back;
+    }
+};
+
+// top-like view of the latest quote per symbol with update rates and latencies, redrawn at a fixed frame rate.
+class Dashboard {
+    TopOfBook &book;
+    std::FILE *out;
+    std::chrono::milliseconds framePeriod;
+    std::atomic<bool> running{false};
+    std::thread thread{};
+    TerminalScreen screen{};
+    std::vector<TopOfBookEntry> entries{};
+    std::vector<std::uint64_t> previousUpdates{};
+    std::uint64_t frames{0};
+
+    static void terminalSize(int &rows, int &cols) {
+        rows = 24;
+        cols = 80;
+
+#ifndef _WIN32
+        winsize ws{};
+
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+            rows = ws.ws_row;
+            cols = ws.ws_col;
+        }
+#endif
+    }
+
+    void compose(double elapsedSeconds) {
+        auto &symbols = book.symbolTable();
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+
+        book.snapshot(entries);
+        previousUpdates.resize(entries.size(), 0);
+        screen.clear();
+
+        double totalRate = 0.0;
+        int row = 2;
+
+        for (std::uint32_t id = 0; id < entries.size(); id++) {
+            auto &e = entries[id];
+            auto rate = static_cast<double>(e.updates - previousUpdates[id]) / elapsedSeconds;
+
+            previousUpdates[id] = e.updates;
+            totalRate += rate;
+
+            if (!e.valid || row >= screen.height()) {
+                continue;
+            }
+
+            auto name = symbols.name(id);
+
+            screen.put(row++, 0,
+                       fmt::format("{:<16.16} {:>12.4f} {:>10.2f} {:>12.4f} {:>10.2f} {:>10.4f} {:>9.1f} {:>9.1f} {:>7.1f} {}",
+                                   std::string(name.begin(), name.end()), e.bidPrice, e.bidSize, e.askPrice, e.askSize,
+                                   e.askPrice - e.bidPrice, rate, e.latencyMillis,
+                                   static_cast<double>(now - e.receiveTime) / 1000.0, e.stale ? "STALE" : ""));
+        }
+
+        screen.put(0, 0,
+                   fmt::format("symbols: {}  updates/s: {:.1f}  frame: {}", entries.size(), totalRate, frames));
+        screen.put(1, 0,
+                   fmt::format("{:<16} {:>12} {:>10} {:>12} {:>10} {:>10} {:>9} {:>9} {:>7}", "SYMBOL", "BID", "BID SZ",
+                               "ASK", "ASK SZ", "SPREAD", "UPD/S", "LAT MS", "AGE S"));
+    }
+
+    void run() {
+        std::string output{};
+        auto previousFrame = std::chrono::steady_clock::now();
+        auto nextFrame = previousFrame + framePeriod;
+
+        output = "\x1b[?25l";
+
+        while (running) {
+            std::this_thread::sleep_until(nextFrame);
+            nextFrame += framePeriod;
+
+            auto now = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::duration<double>(now - previousFrame).count();
+            int rows = 0;
+            int cols = 0;
+
+            previousFrame = now;
+            terminalSize(rows, cols);
+
+            if (rows != screen.height() || cols != screen.width()) {
+                screen.resize(rows, cols);
+                output += "\x1b[2J";
+            }
+
+            compose(elapsed > 0.0 ? elapsed : 1.0);
+            screen.diff(output);
+            frames++;
+
+            if (!output.empty()) {
+                std::fwrite(output.data(), 1, output.size(), out);
+                std::fflush(out);
+                output.clear();
+            }
+        }
+
+        output = fmt::format("\x1b[{};1H\x1b[?25h\n", screen.height());
+        std::fwrite(output.data(), 1, output.size(), out);
+        std::fflush(out);
+    }
+
+  public:
+    Dashboard(TopOfBook &book, std::FILE *out, int framesPerSecond)
+        : book(book), out(out), framePeriod(1000 / std::max(framesPerSecond, 1)) {
+    }
+
+    void start() {
+        running = true;
+        thread = std::thread(&Dashboard::run, this);
+    }
+
+    void stop() {
+        if (running.exchange(false)) {
+            thread.join();
+        }
+    }
+
+    ~Dashboard() {
+        stop();
+    }
+};
@@ -0,0 +1,239 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include "FileSink.hpp"
+
+#if defined(__linux__)
+
+#    include <algorithm>
+#    include <cerrno>
+#    include <condition_variable>
+#    include <cstdint>
+#    include <cstdlib>
+#    include <cstring>
+#    include <thread>
+
+#    include <fcntl.h>
+#    include <unistd.h>
+
+// File sink that bypasses the page cache (O_DIRECT), so long recordings do not evict the working set of co-located
+// processes. Two aligned buffers alternate: the producer fills one while a writer thread writes the other, and the
+// producer only waits if it fills a buffer before the previous write has finished.
+//
+// O_DIRECT needs block-aligned offsets and lengths, so data reaches the file in whole blocks: a full buffer, or on
+// flush() the block-aligned prefix of the current one, whose unaligned rest is carried over into the other buffer. The
+// padded tail is written and truncated to the real length on close.
+class DirectFileSink : public FileSink {
+    static constexpr std::size_t ALIGNMENT = 4096;
+
+    struct Buffer {
+        char *data{nullptr};
+        std::size_t used{0};
+        bool full{false};// handed over to the writer thread
+    };
+
+    std::mutex mutex{};
+    std::condition_variable writerWakeup{};
+    std::condition_variable producerWakeup{};
+    int fd{-1};
+    std::size_t bufferSize;
+    Buffer buffers[2]{};
+    int current{0};
+    std::uint64_t writeOffset{0};// owned by the writer thread
+    bool stopping{false};
+    bool failed{false};
+    std::thread writer{};
+
+    void writeAll(const char *data, std::size_t size, std::uint64_t offset) {
+        SUPDXFD_PROBE2(sink__flush, "direct", size);
+
+        while (size != 0) {
+            auto written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                if (!failed) {
+                    failed = true;
+                    std::fprintf(stderr, "DirectFileSink: write failed: %s\n", std::strerror(errno));
+                }
+
+                return;
+            }
+
+            data += written;
+            size -= static_cast<std::size_t>(written);
+            offset += static_cast<std::uint64_t>(written);
+        }
+    }
+
+    void runWriter() {
+        int next = 0;
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (true) {
+            writerWakeup.wait(lock, [this, next] {
+                return buffers[next].full || stopping;
+            });
+
+            if (!buffers[next].full) {
+                return;
+            }
+
+            auto &b = buffers[next];
+
+            lock.unlock();
+            writeAll(b.data, b.used, writeOffset);
+            writeOffset += b.used;
+            lock.lock();
+
+            b.used = 0;
+            b.full = false;
+            producerWakeup.notify_one();
+            next ^= 1;
+        }
+    }
+
+    DirectFileSink(int fd, std::size_t bufferSize) : fd(fd), bufferSize(bufferSize) {
+    }
+
+  public:
+    // Returns nullptr if the file cannot be opened with O_DIRECT (e.g. tmpfs) or memory cannot be allocated.
+    static std::unique_ptr<FileSink> open(const std::string &path, std::size_t bufferSize = 4 << 20) {
+        bufferSize = (bufferSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        std::unique_ptr<DirectFileSink> sink{new DirectFileSink(fd, bufferSize)};
+
+        for (auto &b : sink->buffers) {
+            void *memory = nullptr;
+
+            if (posix_memalign(&memory, ALIGNMENT, bufferSize) != 0) {
+                return nullptr;
+            }
+
+            b.data = static_cast<char *>(memory);
+        }
+
+        sink->writer = std::thread(&DirectFileSink::runWriter, sink.get());
+
+        return sink;
+    }
+
+    void write(const char *data, std::size_t size) override {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (size != 0) {
+            auto *b = &buffers[current];
+
+            if (b->full) {
+                producerWakeup.wait(lock, [b] {
+                    return !b->full;
+                });
+            }
+
+            auto chunk = std::min(size, bufferSize - b->used);
+
+            std::memcpy(b->data + b->used, data, chunk);
+            b->used += chunk;
+            data += chunk;
+            size -= chunk;
+
+            if (b->used == bufferSize) {
+                b->full = true;
+                current ^= 1;
+                writerWakeup.notify_one();
+            }
+        }
+    }
+
+    void flush() override {
+        std::unique_lock<std::mutex> lock{mutex};
+        auto *b = &buffers[current];
+        auto aligned = b->used / ALIGNMENT * ALIGNMENT;
+
+        if (b->full || aligned == 0) {
+            return;
+        }
+
+        auto *next = &buffers[current ^ 1];
+
+        producerWakeup.wait(lock, [next] {
+            return !next->full;
+        });
+
+        std::memcpy(next->data, b->data + aligned, b->used - aligned);
+        next->used = b->used - aligned;
+        b->used = aligned;
+        b->full = true;
+        current ^= 1;
+        writerWakeup.notify_one();
+    }
+
+    ~DirectFileSink() override {
+        std::uint64_t tailSize = 0;
+
+        if (writer.joinable()) {
+            std::unique_lock<std::mutex> lock{mutex};
+            auto &tail = buffers[current];
+
+            // The writer handles buffers in order, so the tail goes out after any full buffer still pending.
+            if (tail.used != 0 && !tail.full) {
+                tailSize = tail.used;
+
+                auto padded = (tail.used + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+                std::memset(tail.data + tail.used, 0, padded - tail.used);
+                tail.used = padded;
+                tail.full = true;
+            }
+
+            stopping = true;
+            writerWakeup.notify_one();
+            lock.unlock();
+            writer.join();
+        }
+
+        if (fd >= 0) {
+            if (tailSize != 0) {
+                auto padding = (ALIGNMENT - tailSize % ALIGNMENT) % ALIGNMENT;
+
+                if (ftruncate(fd, static_cast<off_t>(writeOffset - padding)) != 0) {
+                    std::fprintf(stderr, "DirectFileSink: truncate failed: %s\n", std::strerror(errno));
+                }
+            }
+
+            ::close(fd);
+        }
+
+        for (auto &b : buffers) {
+            std::free(b.data);
+        }
+    }
+};
+
+#endif// __linux__
+
+// Opens an O_DIRECT sink where supported, otherwise a stdio one.
+inline std::unique_ptr<FileSink> openDirectFileSink(const std::string &path) {
+#if defined(__linux__)
+    auto sink = DirectFileSink::open(path);
+
+    if (sink) {
+        return sink;
+    }
+
+    std::fprintf(stderr, "O_DIRECT is not available for %s, falling back to buffered writes\n", path.c_str());
+#endif
+
+    return StdioFileSink::open(path, 1 << 20);
+}
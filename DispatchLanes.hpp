@@ -0,0 +1,367 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <DXFeed.h>
+
+#include "Probes.hpp"
+#include "TradeClassifier.hpp"
+
+enum class LanePriority { CRITICAL,
+                          BULK };
+
+// One listener call, copied so that lanes can consume it after the listener has returned.
+struct EventBatch {
+    int eventType{0};
+    std::wstring symbol{};
+    std::uint32_t symbolId{0};
+    std::size_t listenerId{0};
+    int count{0};
+    std::vector<char> data{};                            // `count` C API event structs of `eventType`
+    std::vector<TradeClassification> classifications{};  // per trade, if trades are classified
+    std::vector<std::uint8_t> aggressorSides{};          // the same, as binproto::AggressorSide
+    void (*print)(const EventBatch &batch){nullptr};     // console output of the originating subscription
+    std::uint64_t traceIntake{0};                        // stage trace stamps, zero if the batch is not sampled
+    std::uint64_t traceCopied{0};
+
+    template<typename T>
+    void assign(int type, const T *events, int n) {
+        eventType = type;
+        count = n;
+        data.resize(sizeof(T) * static_cast<std::size_t>(n));
+
+        if (n > 0) {
+            std::memcpy(data.data(), events, data.size());
+        }
+    }
+
+    template<typename T>
+    const T *events() const {
+        return reinterpret_cast<const T *>(data.data());
+    }
+
+    const TradeClassification *classified() const {
+        return classifications.empty() ? nullptr : classifications.data();
+    }
+
+    const std::uint8_t *sides() const {
+        return aggressorSides.empty() ? nullptr : aggressorSides.data();
+    }
+};
+
+// Fans listener batches out to consumers on dispatch lanes, each a bounded queue with its own thread. Every
+// CRITICAL consumer gets a dedicated lane; BULK consumers (recording, text output) share a few best-effort lanes.
+// publish() enqueues to the critical lanes first, so a slow bulk consumer delays neither the listener nor the
+// critical consumers. A full lane drops the batch and counts it rather than blocking the listener.
+//
+// A consumer may declare a latency target. It then gets a lane of its own, whose queueing delay is measured on every
+// batch (smoothed over about 8 batches). Once the delay exceeds the target, the lane switches to conflated delivery:
+// a newer batch of the same symbol and event type replaces the one still queued, whichever subscription it came from,
+// and the consumer sees only the latest state of each symbol. The lane returns to full-stream delivery when the delay
+// falls below half the target, but not before it has been conflated for a second, so a lane under sustained overload
+// does not flap.
+class Dispatcher {
+  public:
+    using Consumer = std::function<void(const EventBatch &)>;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::shared_ptr<const EventBatch> batch{};// null if merged into an earlier entry of the same key
+        Clock::time_point enqueued{};
+        std::uint64_t key{0};
+    };
+
+    struct Lane {
+        std::string name{};
+        std::size_t capacity{0};
+        std::vector<Consumer> consumers{};
+        std::mutex mutex{};
+        std::condition_variable wakeup{};
+        std::deque<Entry> queue{};
+        bool stopping{false};
+        std::uint64_t dropped{0};
+        std::thread thread{};
+
+        Clock::duration latencyTarget{0};// zero: always full-stream
+        bool conflated{false};
+        Clock::time_point conflatedSince{};
+        std::unordered_map<std::uint64_t, std::uint64_t> pending{};// key -> sequence of its entry, when conflated
+        std::uint64_t popped{0};                                  // sequence of queue.front()
+        double delayNanos{0.0};
+        std::uint64_t replaced{0};
+        std::uint64_t switches{0};
+    };
+
+    std::size_t capacity;
+    std::vector<std::unique_ptr<Lane>> criticalLanes{};
+    std::vector<std::unique_ptr<Lane>> bulkLanes{};
+    std::size_t nextBulkLane{0};
+    bool started{false};
+
+    // The subscription (listenerId) is deliberately not part of the key: conflated consumers keep per-symbol state.
+    // A consumer that must tell subscriptions apart cannot be conflated unless the key also includes it.
+    static std::uint64_t keyOf(const EventBatch &batch) {
+        return (static_cast<std::uint64_t>(batch.symbolId) << 32) | static_cast<std::uint32_t>(batch.eventType);
+    }
+
+    // Indexes the queued entries by key, moving the latest batch of each key into its earliest entry.
+    static void conflate(Lane &lane) {
+        lane.conflated = true;
+        lane.pending.clear();
+
+        for (std::size_t i = 0; i < lane.queue.size(); i++) {
+            auto &entry = lane.queue[i];
+            auto inserted = lane.pending.emplace(entry.key, lane.popped + i);
+
+            if (!inserted.second && entry.batch) {
+                lane.queue[inserted.first->second - lane.popped].batch = std::move(entry.batch);
+                entry.batch.reset();
+                lane.replaced++;
+            }
+        }
+    }
+
+    // Called with the lane lock held for every delivered batch of a lane with a latency target.
+    static void adapt(Lane &lane, Clock::duration delay, Clock::time_point now) {
+        using Nanos = std::chrono::duration<double, std::nano>;
+        auto nanos = std::chrono::duration_cast<Nanos>(delay).count();
+        auto target = std::chrono::duration_cast<Nanos>(lane.latencyTarget).count();
+
+        lane.delayNanos += (nanos - lane.delayNanos) / 8;
+
+        if (!lane.conflated && lane.delayNanos > target) {
+            conflate(lane);
+            lane.conflatedSince = now;
+            lane.switches++;
+        } else if (lane.conflated && lane.delayNanos < target / 2 &&
+                   now - lane.conflatedSince >= std::chrono::seconds(1)) {
+            lane.conflated = false;
+            lane.pending.clear();
+            lane.switches++;
+        }
+    }
+
+    static void run(Lane &lane) {
+        std::unique_lock<std::mutex> lock{lane.mutex};
+
+        while (true) {
+            lane.wakeup.wait(lock, [&lane] {
+                return !lane.queue.empty() || lane.stopping;
+            });
+
+            if (lane.queue.empty()) {
+                return;
+            }
+
+            auto entry = std::move(lane.queue.front());
+
+            lane.queue.pop_front();
+            lane.popped++;
+            SUPDXFD_PROBE2(lane__dequeue, lane.name.c_str(), lane.queue.size());
+
+            if (lane.conflated) {
+                auto found = lane.pending.find(entry.key);
+
+                if (found != lane.pending.end() && found->second == lane.popped - 1) {
+                    lane.pending.erase(found);
+                }
+            }
+
+            if (!entry.batch) {
+                continue;
+            }
+
+            if (lane.latencyTarget.count() > 0) {
+                auto now = Clock::now();
+
+                adapt(lane, now - entry.enqueued, now);
+            }
+
+            lock.unlock();
+
+            for (auto &consume : lane.consumers) {
+                consume(*entry.batch);
+            }
+
+            lock.lock();
+        }
+    }
+
+    static void push(Lane &lane, const std::shared_ptr<const EventBatch> &batch, Clock::time_point now) {
+        {
+            std::lock_guard<std::mutex> lock{lane.mutex};
+            auto key = keyOf(*batch);
+
+            if (lane.conflated) {
+                auto found = lane.pending.find(key);
+
+                if (found != lane.pending.end()) {
+                    lane.queue[found->second - lane.popped].batch = batch;
+                    lane.replaced++;
+
+                    return;
+                }
+            }
+
+            if (lane.queue.size() >= lane.capacity) {
+                lane.dropped++;
+
+                return;
+            }
+
+            if (lane.conflated) {
+                lane.pending.emplace(key, lane.popped + lane.queue.size());
+            }
+
+            lane.queue.push_back(Entry{batch, now, key});
+            SUPDXFD_PROBE2(lane__enqueue, lane.name.c_str(), lane.queue.size());
+        }
+
+        lane.wakeup.notify_one();
+    }
+
+    template<typename F>
+    void forEachLane(F f) {
+        for (auto &lane : criticalLanes) {
+            f(*lane);
+        }
+
+        for (auto &lane : bulkLanes) {
+            f(*lane);
+        }
+    }
+
+  public:
+    explicit Dispatcher(std::size_t bulkLaneCount = 1, std::size_t capacity = 1 << 16) : capacity(capacity) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(bulkLaneCount, 1); i++) {
+            bulkLanes.emplace_back(new Lane{});
+            bulkLanes.back()->name = fmt::format("bulk-{}", i);
+            bulkLanes.back()->capacity = capacity;
+        }
+    }
+
+    // Consumers are registered before start(). A non-zero latency target marks a consumer that accepts conflated
+    // delivery; such a consumer gets a dedicated lane even if it is BULK.
+    void addConsumer(const std::string &name, LanePriority priority, Consumer consumer,
+                     std::chrono::microseconds latencyTarget = std::chrono::microseconds(0)) {
+        if (priority == LanePriority::BULK && latencyTarget.count() == 0) {
+            bulkLanes[nextBulkLane++ % bulkLanes.size()]->consumers.push_back(std::move(consumer));
+
+            return;
+        }
+
+        auto &lanes = priority == LanePriority::CRITICAL ? criticalLanes : bulkLanes;
+
+        lanes.emplace_back(new Lane{});
+        lanes.back()->name = name;
+        lanes.back()->capacity = capacity;
+        lanes.back()->latencyTarget = latencyTarget;
+        lanes.back()->consumers.push_back(std::move(consumer));
+    }
+
+    bool hasConsumers() const {
+        if (!criticalLanes.empty()) {
+            return true;
+        }
+
+        for (auto &lane : bulkLanes) {
+            if (!lane->consumers.empty()) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void start() {
+        started = true;
+        forEachLane([](Lane &lane) {
+            if (!lane.consumers.empty()) {
+                lane.thread = std::thread(&Dispatcher::run, std::ref(lane));
+            }
+        });
+    }
+
+    void publish(const std::shared_ptr<const EventBatch> &batch) {
+        auto now = Clock::now();
+
+        forEachLane([&batch, now](Lane &lane) {
+            if (!lane.consumers.empty()) {
+                push(lane, batch, now);
+            }
+        });
+    }
+
+    // Drains the lanes and joins their threads.
+    void stop() {
+        if (!started) {
+            return;
+        }
+
+        started = false;
+        forEachLane([](Lane &lane) {
+            {
+                std::lock_guard<std::mutex> lock{lane.mutex};
+
+                lane.stopping = true;
+            }
+
+            lane.wakeup.notify_one();
+
+            if (lane.thread.joinable()) {
+                lane.thread.join();
+            }
+        });
+    }
+
+    ~Dispatcher() {
+        stop();
+    }
+
+    // One line per lane with its queue depth and dropped batch count, and for lanes with a latency target the
+    // delivery mode, smoothed queueing delay, mode switches and batches replaced by conflation.
+    std::string stats() {
+        std::string text{};
+
+        forEachLane([&text](Lane &lane) {
+            if (lane.consumers.empty()) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock{lane.mutex};
+
+            text += fmt::format("Lane {}: {} consumers, {} queued, {} dropped", lane.name, lane.consumers.size(),
+                                lane.queue.size(), lane.dropped);
+
+            if (lane.latencyTarget.count() > 0) {
+                text += fmt::format(", {}, delay = {:.0f} us (target {} us), {} switches, {} conflated",
+                                    lane.conflated ? "conflated" : "full-stream", lane.delayNanos / 1000,
+                                    std::chrono::duration_cast<std::chrono::microseconds>(lane.latencyTarget).count(),
+                                    lane.switches, lane.replaced);
+            }
+
+            text += "\n";
+        });
+
+        return text;
+    }
+};
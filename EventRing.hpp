@@ -0,0 +1,237 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "DispatchLanes.hpp"
+#include "Probes.hpp"
+
+// A disruptor-style alternative to the dispatch lanes: listeners write each batch once, in place, into a slot of a
+// preallocated ring, and every consumer reads the slots in place on its own thread, tracking its own sequence. A
+// consumer may run after others; it then sees a slot only once all of them have passed it (a barrier is the minimum
+// of their sequences), so a dependent consumer can rely on their side effects without a lock or a copy.
+//
+// Publishing claims a sequence with a CAS and publishes in claim order. The slowest consumer gates the producers: if
+// the ring is full, the batch is dropped and counted rather than blocking the listener. Slots keep the capacity of
+// their buffers, so a warmed-up ring publishes without allocating. There is no conflation, so a latency target
+// passed to addConsumer() is ignored, as is the priority: every consumer already has a thread of its own.
+class EventRing {
+  public:
+    using Consumer = std::function<void(const EventBatch &)>;
+
+  private:
+    // Padded to a cache line, so that a consumer advancing its sequence does not invalidate its neighbour's.
+    struct Sequence {
+        std::atomic<std::int64_t> value{-1};
+        char padding[64 - sizeof(std::atomic<std::int64_t>)]{};
+    };
+
+    struct Reader {
+        std::string name{};
+        Consumer consume{};
+        std::vector<std::size_t> after{};
+        Sequence sequence{};
+        std::thread thread{};
+    };
+
+    std::vector<EventBatch> slots;
+    std::size_t mask;
+    Sequence claimed{};
+    Sequence cursor{};// the last published sequence
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<bool> stopping{false};
+    std::vector<std::unique_ptr<Reader>> readers{};
+    bool started{false};
+
+    static std::size_t roundUp(std::size_t capacity) {
+        std::size_t size = 2;
+
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        return size;
+    }
+
+    std::int64_t slowest() const {
+        auto minimum = cursor.value.load(std::memory_order_acquire);
+
+        for (auto &r : readers) {
+            minimum = std::min(minimum, r->sequence.value.load(std::memory_order_acquire));
+        }
+
+        return minimum;
+    }
+
+    // Spins briefly, then yields, then sleeps: consumers never take a lock to wait.
+    static void idle(int &rounds) {
+        if (rounds < 64) {
+            rounds++;
+        } else if (rounds < 128) {
+            rounds++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void run(Reader &reader) {
+        auto next = reader.sequence.value.load(std::memory_order_relaxed) + 1;
+        int rounds = 0;
+
+        while (true) {
+            auto available = cursor.value.load(std::memory_order_acquire);
+
+            for (auto d : reader.after) {
+                available = std::min(available, readers[d]->sequence.value.load(std::memory_order_acquire));
+            }
+
+            if (available < next) {
+                if (stopping.load(std::memory_order_acquire) && next > claimed.value.load(std::memory_order_acquire)) {
+                    return;
+                }
+
+                idle(rounds);
+
+                continue;
+            }
+
+            SUPDXFD_PROBE3(ring__consume, reader.name.c_str(), next, available);
+
+            for (auto s = next; s <= available; s++) {
+                reader.consume(slots[static_cast<std::size_t>(s) & mask]);
+            }
+
+            reader.sequence.value.store(available, std::memory_order_release);
+            next = available + 1;
+            rounds = 0;
+        }
+    }
+
+    std::size_t indexOf(const std::string &name) const {
+        for (std::size_t i = 0; i < readers.size(); i++) {
+            if (readers[i]->name == name) {
+                return i;
+            }
+        }
+
+        return readers.size();
+    }
+
+  public:
+    explicit EventRing(std::size_t capacity = 1 << 12) : slots(roundUp(capacity)), mask(slots.size() - 1) {
+    }
+
+    // Consumers are registered before start().
+    void addConsumer(const std::string &name, LanePriority, Consumer consumer,
+                     std::chrono::microseconds = std::chrono::microseconds(0)) {
+        readers.emplace_back(new Reader{});
+        readers.back()->name = name;
+        readers.back()->consume = std::move(consumer);
+    }
+
+    // Makes `consumer` see each batch only after `dependency` has processed it. Returns false if either is not
+    // registered or the dependency was registered later, which keeps the graph acyclic.
+    bool runAfter(const std::string &consumer, const std::string &dependency) {
+        auto c = indexOf(consumer);
+        auto d = indexOf(dependency);
+
+        if (c == readers.size() || d >= c) {
+            return false;
+        }
+
+        readers[c]->after.push_back(d);
+
+        return true;
+    }
+
+    bool hasConsumers() const {
+        return !readers.empty();
+    }
+
+    void start() {
+        started = true;
+
+        for (auto &r : readers) {
+            r->thread = std::thread(&EventRing::run, this, std::ref(*r));
+        }
+    }
+
+    // Claims a slot and lets `fill(EventBatch &)` write the batch into it. Returns false if the ring was full.
+    template<typename F>
+    bool publish(F fill) {
+        auto sequence = claimed.value.load(std::memory_order_relaxed);
+
+        do {
+            if (sequence + 1 - slowest() > static_cast<std::int64_t>(slots.size())) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+
+                return false;
+            }
+        } while (!claimed.value.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acq_rel));
+
+        fill(slots[static_cast<std::size_t>(sequence + 1) & mask]);
+
+        // Publish in claim order: wait for the producers that claimed earlier sequences.
+        while (cursor.value.load(std::memory_order_acquire) != sequence) {
+            std::this_thread::yield();
+        }
+
+        cursor.value.store(sequence + 1, std::memory_order_release);
+        SUPDXFD_PROBE1(ring__publish, sequence + 1);
+
+        return true;
+    }
+
+    // Lets the consumers drain the ring and joins their threads.
+    void stop() {
+        if (!started) {
+            return;
+        }
+
+        started = false;
+        stopping = true;
+
+        for (auto &r : readers) {
+            if (r->thread.joinable()) {
+                r->thread.join();
+            }
+        }
+    }
+
+    ~EventRing() {
+        stop();
+    }
+
+    // The published and dropped batch counts, then one line per consumer with its lag behind the producers.
+    std::string stats() const {
+        auto published = cursor.value.load(std::memory_order_acquire) + 1;
+        auto text = fmt::format("Ring: {} slots, {} published, {} dropped\n", slots.size(), published,
+                                dropped.load(std::memory_order_relaxed));
+
+        for (auto &r : readers) {
+            text += fmt::format("Ring consumer {}: {} behind", r->name,
+                                published - 1 - r->sequence.value.load(std::memory_order_acquire));
+
+            for (std::size_t i = 0; i < r->after.size(); i++) {
+                text += fmt::format("{}{}", i == 0 ? ", after " : ", ", readers[r->after[i]]->name);
+            }
+
+            text += "\n";
+        }
+
+        return text;
+    }
+};
@@ -0,0 +1,271 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "SymbolTable.hpp"
+
+enum class TimelineEventType : std::uint8_t { QUOTE,
+                                              TRADE,
+                                              ORDER };
+
+inline const char *timelineEventTypeToString(TimelineEventType type) {
+    switch (type) {
+        case TimelineEventType::QUOTE:
+            return "Quote";
+        case TimelineEventType::TRADE:
+            return "Trade";
+        case TimelineEventType::ORDER:
+            return "Order";
+    }
+
+    return "";
+}
+
+// One event of a symbol timeline. Events are copied by value; pointer members of the C API structs (e.g. an order's
+// market maker) are only valid inside the listener and must not be used by handlers.
+struct TimelineEvent {
+    TimelineEventType type{TimelineEventType::QUOTE};
+    bool late{false};       // arrived after a later event of the symbol had already been delivered
+    std::uint32_t symbolId{0};
+    std::uint64_t intake{0};// global arrival order
+    std::int64_t timeNanos{0};// event time, ns since epoch
+    std::int64_t receiveMillis{0};
+
+    union {
+        dxf_quote_t quote;
+        dxf_trade_t trade;
+        dxf_order_t order;
+    };
+
+    TimelineEvent() : quote{} {
+    }
+};
+
+// Merges the quotes, trades and orders of each symbol into one stream ordered by event time. Events pass through a
+// small per-symbol reorder buffer (a heap on event time, then intake order) and are released in that order when the
+// buffer is full or the event that arrived first has waited `hold`, so no event waits longer. The handler sees each
+// symbol's events in order, one call at a time per symbol; an event older than one already released cannot be
+// reordered and is delivered at once, flagged late.
+class EventTimeline {
+  public:
+    using Handler = std::function<void(const TimelineEvent &)>;
+
+  private:
+    struct SymbolTimeline {
+        std::mutex mutex{};
+        std::vector<TimelineEvent> buffer{};// min-heap
+        std::int64_t lastReleased{std::numeric_limits<std::int64_t>::min()};
+    };
+
+    SymbolTable &symbols;
+    std::size_t capacity;
+    std::chrono::milliseconds hold;
+    Handler handler;
+    std::atomic<std::uint64_t> intake{0};
+    std::atomic<std::uint64_t> lateEvents{0};
+    std::mutex indexMutex{};
+    std::vector<std::unique_ptr<SymbolTimeline>> timelines{};
+    std::atomic<bool> running{false};
+    std::thread flusher{};
+
+    static std::int64_t nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Heap order: the earliest event on top.
+    static bool later(const TimelineEvent &a, const TimelineEvent &b) {
+        return a.timeNanos != b.timeNanos ? a.timeNanos > b.timeNanos : a.intake > b.intake;
+    }
+
+    SymbolTimeline *lookup(std::uint32_t symbolId) {
+        std::lock_guard<std::mutex> lock{indexMutex};
+
+        if (symbolId >= timelines.size()) {
+            timelines.resize(symbolId + 1);
+        }
+
+        if (!timelines[symbolId]) {
+            timelines[symbolId].reset(new SymbolTimeline{});
+        }
+
+        return timelines[symbolId].get();
+    }
+
+    void releaseTop(SymbolTimeline &t) {
+        std::pop_heap(t.buffer.begin(), t.buffer.end(), later);
+        t.lastReleased = std::max(t.lastReleased, t.buffer.back().timeNanos);
+        handler(t.buffer.back());
+        t.buffer.pop_back();
+    }
+
+    // The arrival time of the longest-waiting event; the buffer is small, so it is scanned.
+    static std::int64_t firstArrival(const SymbolTimeline &t) {
+        auto first = t.buffer.front().receiveMillis;
+
+        for (auto &e : t.buffer) {
+            first = std::min(first, e.receiveMillis);
+        }
+
+        return first;
+    }
+
+    // Releases what is due; `all` drains the buffer. Called with the symbol lock held.
+    void release(SymbolTimeline &t, std::int64_t now, bool all) {
+        while (!t.buffer.empty() && (all || t.buffer.size() > capacity || firstArrival(t) + hold.count() <= now)) {
+            releaseTop(t);
+        }
+    }
+
+    void push(TimelineEvent &event) {
+        auto *t = lookup(event.symbolId);
+        std::lock_guard<std::mutex> lock{t->mutex};
+
+        event.intake = intake++;
+        event.receiveMillis = nowMillis();
+        event.late = event.timeNanos < t->lastReleased;
+
+        if (event.late) {
+            lateEvents++;
+            handler(event);
+
+            return;
+        }
+
+        t->buffer.push_back(event);
+        std::push_heap(t->buffer.begin(), t->buffer.end(), later);
+        release(*t, event.receiveMillis, false);
+    }
+
+    void flushDue(bool all) {
+        std::vector<SymbolTimeline *> snapshot{};
+
+        {
+            std::lock_guard<std::mutex> lock{indexMutex};
+
+            for (auto &t : timelines) {
+                if (t) {
+                    snapshot.push_back(t.get());
+                }
+            }
+        }
+
+        auto now = nowMillis();
+
+        for (auto *t : snapshot) {
+            std::lock_guard<std::mutex> lock{t->mutex};
+
+            release(*t, now, all);
+        }
+    }
+
+    void run() {
+        auto period = std::max(hold / 2, std::chrono::milliseconds(1));
+
+        while (running) {
+            std::this_thread::sleep_for(period);
+            flushDue(false);
+        }
+    }
+
+    static std::int64_t eventTime(std::int64_t millis, std::int32_t nanos) {
+        return millis * 1000000 + nanos;
+    }
+
+  public:
+    EventTimeline(SymbolTable &symbols, Handler handler, std::size_t capacity = 64,
+                  std::chrono::milliseconds hold = std::chrono::milliseconds(20))
+        : symbols(symbols), capacity(std::max<std::size_t>(capacity, 1)), hold(hold), handler(std::move(handler)) {
+    }
+
+    void start() {
+        running = true;
+        flusher = std::thread(&EventTimeline::run, this);
+    }
+
+    // Stops the flusher and delivers everything still buffered.
+    void stop() {
+        running = false;
+
+        if (flusher.joinable()) {
+            flusher.join();
+        }
+
+        flushDue(true);
+    }
+
+    ~EventTimeline() {
+        stop();
+    }
+
+    std::uint64_t lateCount() const {
+        return lateEvents;
+    }
+
+    void onQuotes(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count) {
+        onQuotes(symbols.intern(symbolName).first, quotes, count);
+    }
+
+    void onTrades(dxf_const_string_t symbolName, const dxf_trade_t *trades, int count) {
+        onTrades(symbols.intern(symbolName).first, trades, count);
+    }
+
+    void onOrders(dxf_const_string_t symbolName, const dxf_order_t *orders, int count) {
+        onOrders(symbols.intern(symbolName).first, orders, count);
+    }
+
+    // The same for a symbol already interned in the timeline's symbol table.
+    void onQuotes(std::uint32_t symbolId, const dxf_quote_t *quotes, int count) {
+        TimelineEvent e{};
+
+        e.type = TimelineEventType::QUOTE;
+        e.symbolId = symbolId;
+
+        for (int i = 0; i < count; i++) {
+            e.quote = quotes[i];
+            e.timeNanos = eventTime(quotes[i].time, quotes[i].time_nanos);
+            push(e);
+        }
+    }
+
+    void onTrades(std::uint32_t symbolId, const dxf_trade_t *trades, int count) {
+        TimelineEvent e{};
+
+        e.type = TimelineEventType::TRADE;
+        e.symbolId = symbolId;
+
+        for (int i = 0; i < count; i++) {
+            e.trade = trades[i];
+            e.timeNanos = eventTime(trades[i].time, trades[i].time_nanos);
+            push(e);
+        }
+    }
+
+    void onOrders(std::uint32_t symbolId, const dxf_order_t *orders, int count) {
+        TimelineEvent e{};
+
+        e.type = TimelineEventType::ORDER;
+        e.symbolId = symbolId;
+
+        for (int i = 0; i < count; i++) {
+            e.order = orders[i];
+            e.timeNanos = eventTime(orders[i].time, orders[i].time_nanos);
+            push(e);
+        }
+    }
+};
@@ -0,0 +1,91 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Probes.hpp"
+
+// Byte sink behind the file outputs (text logs, tapes). Implementations are thread-safe.
+struct FileSink {
+    virtual ~FileSink() = default;
+
+    // Appends bytes. May buffer; never guarantees the data reached the file.
+    virtual void write(const char *data, std::size_t size) = 0;
+
+    // Hands buffered data over to the OS without waiting for it to be written.
+    virtual void flush() = 0;
+};
+
+// Synchronous sink over stdio with a large user-space buffer. The portable fallback. The buffer is the sink's own
+// (the FILE is unbuffered), so every hand-over to the OS, whether the buffer filled up or was flushed, goes through
+// drain() and fires the sink__flush probe.
+class StdioFileSink : public FileSink {
+    std::mutex mutex{};
+    std::FILE *file{nullptr};
+    std::vector<char> buffer{};
+    std::size_t capacity{0};
+
+    // Called with the lock held.
+    void drain(const char *data, std::size_t size) {
+        if (size == 0) {
+            return;
+        }
+
+        SUPDXFD_PROBE2(sink__flush, "stdio", size);
+        std::fwrite(data, 1, size, file);
+    }
+
+  public:
+    static std::unique_ptr<FileSink> open(const std::string &path, std::size_t bufferSize) {
+        std::unique_ptr<StdioFileSink> sink{new StdioFileSink{}};
+
+        sink->file = std::fopen(path.c_str(), "wb");
+
+        if (!sink->file) {
+            return nullptr;
+        }
+
+        std::setvbuf(sink->file, nullptr, _IONBF, 0);
+        sink->capacity = std::max<std::size_t>(bufferSize, 1);
+        sink->buffer.reserve(sink->capacity);
+
+        return sink;
+    }
+
+    void write(const char *data, std::size_t size) override {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (buffer.size() + size > capacity) {
+            drain(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+
+        if (size >= capacity) {
+            drain(data, size);
+        } else {
+            buffer.insert(buffer.end(), data, data + size);
+        }
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        drain(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    ~StdioFileSink() override {
+        if (file) {
+            drain(buffer.data(), buffer.size());
+            std::fclose(file);
+        }
+    }
+};
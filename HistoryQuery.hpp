@@ -0,0 +1,453 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#endif
+
+#include "QuoteHistory.hpp"
+
+// Filter and aggregate kernels over history columns. Each kernel has an AVX2 or SSE2 body and a scalar tail.
+namespace kernels {
+
+// mask[i] = 0xFF if scope[i] == value, else 0.
+inline void selectEqual(const std::uint8_t *scope, std::size_t n, std::uint8_t value, std::uint8_t *mask) {
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    auto needle = _mm256_set1_epi8(static_cast<char>(value));
+
+    for (; i + 32 <= n; i += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(scope + i));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(mask + i), _mm256_cmpeq_epi8(v, needle));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    auto needle = _mm_set1_epi8(static_cast<char>(value));
+
+    for (; i + 16 <= n; i += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(scope + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(mask + i), _mm_cmpeq_epi8(v, needle));
+    }
+#endif
+
+    for (; i < n; i++) {
+        mask[i] = scope[i] == value ? 0xFF : 0;
+    }
+}
+
+// out[i] = a[i] * ka + b[i] * kb; covers spread (ask - bid) and mid ((ask + bid) / 2).
+inline void combine(const double *a, double ka, const double *b, double kb, std::size_t n, double *out) {
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    auto va = _mm256_set1_pd(ka);
+    auto vb = _mm256_set1_pd(kb);
+
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm256_mul_pd(_mm256_loadu_pd(a + i), va);
+        auto y = _mm256_mul_pd(_mm256_loadu_pd(b + i), vb);
+
+        _mm256_storeu_pd(out + i, _mm256_add_pd(x, y));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    auto va = _mm_set1_pd(ka);
+    auto vb = _mm_set1_pd(kb);
+
+    for (; i + 2 <= n; i += 2) {
+        auto x = _mm_mul_pd(_mm_loadu_pd(a + i), va);
+        auto y = _mm_mul_pd(_mm_loadu_pd(b + i), vb);
+
+        _mm_storeu_pd(out + i, _mm_add_pd(x, y));
+    }
+#endif
+
+    for (; i < n; i++) {
+        out[i] = a[i] * ka + b[i] * kb;
+    }
+}
+
+struct Aggregate {
+    std::uint64_t count{0};
+    double sum{0.0};
+    double min{std::numeric_limits<double>::infinity()};
+    double max{-std::numeric_limits<double>::infinity()};
+
+    void merge(const Aggregate &other) {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+// Computes count/sum/min/max of values[i] where mask[i] != 0 (all values if mask is null).
+inline Aggregate aggregate(const double *values, const std::uint8_t *mask, std::size_t n) {
+    Aggregate result{};
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    auto sum = _mm256_setzero_pd();
+    auto min = _mm256_set1_pd(result.min);
+    auto max = _mm256_set1_pd(result.max);
+    auto zero = _mm256_setzero_pd();
+    std::uint64_t count = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        auto v = _mm256_loadu_pd(values + i);
+        auto select = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+        if (mask) {
+            std::int32_t bytes;
+
+            std::memcpy(&bytes, mask + i, sizeof(bytes));
+            select = _mm256_castsi256_pd(_mm256_cvtepi8_epi64(_mm_cvtsi32_si128(bytes)));
+
+            auto bits = _mm256_movemask_pd(select);
+
+            count += (bits & 1) + (bits >> 1 & 1) + (bits >> 2 & 1) + (bits >> 3 & 1);
+        } else {
+            count += 4;
+        }
+
+        sum = _mm256_add_pd(sum, _mm256_blendv_pd(zero, v, select));
+        min = _mm256_min_pd(min, _mm256_blendv_pd(min, v, select));
+        max = _mm256_max_pd(max, _mm256_blendv_pd(max, v, select));
+    }
+
+    alignas(32) double lanes[3][4];
+
+    _mm256_store_pd(lanes[0], sum);
+    _mm256_store_pd(lanes[1], min);
+    _mm256_store_pd(lanes[2], max);
+
+    for (int lane = 0; lane < 4; lane++) {
+        result.sum += lanes[0][lane];
+        result.min = std::min(result.min, lanes[1][lane]);
+        result.max = std::max(result.max, lanes[2][lane]);
+    }
+
+    result.count = count;
+#elif defined(__SSE2__) || defined(_M_X64)
+    auto sum = _mm_setzero_pd();
+    auto min = _mm_set1_pd(result.min);
+    auto max = _mm_set1_pd(result.max);
+    std::uint64_t count = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        auto v = _mm_loadu_pd(values + i);
+        auto select = _mm_castsi128_pd(_mm_set1_epi32(-1));
+
+        if (mask) {
+            select = _mm_castsi128_pd(_mm_set_epi64x(mask[i + 1] ? -1 : 0, mask[i] ? -1 : 0));
+            count += (mask[i] ? 1 : 0) + (mask[i + 1] ? 1 : 0);
+        } else {
+            count += 2;
+        }
+
+        // SSE2 has no blend: select via and/andnot.
+        auto picked = _mm_and_pd(select, v);
+
+        sum = _mm_add_pd(sum, picked);
+        min = _mm_min_pd(min, _mm_or_pd(picked, _mm_andnot_pd(select, min)));
+        max = _mm_max_pd(max, _mm_or_pd(picked, _mm_andnot_pd(select, max)));
+    }
+
+    alignas(16) double lanes[3][2];
+
+    _mm_store_pd(lanes[0], sum);
+    _mm_store_pd(lanes[1], min);
+    _mm_store_pd(lanes[2], max);
+
+    for (int lane = 0; lane < 2; lane++) {
+        result.sum += lanes[0][lane];
+        result.min = std::min(result.min, lanes[1][lane]);
+        result.max = std::max(result.max, lanes[2][lane]);
+    }
+
+    result.count = count;
+#endif
+
+    for (; i < n; i++) {
+        if (mask && !mask[i]) {
+            continue;
+        }
+
+        result.count++;
+        result.sum += values[i];
+        result.min = std::min(result.min, values[i]);
+        result.max = std::max(result.max, values[i]);
+    }
+
+    return result;
+}
+
+}// namespace kernels
+
+enum class QueryAggregate { COUNT,
+                            MIN,
+                            MAX,
+                            SUM,
+                            AVG };
+
+enum class QueryColumn { BID,
+                         ASK,
+                         MID,
+                         SPREAD,
+                         BID_SIZE,
+                         ASK_SIZE };
+
+struct HistoryQuery {
+    QueryAggregate aggregate{QueryAggregate::COUNT};
+    QueryColumn column{QueryColumn::BID};
+    std::chrono::milliseconds window{std::chrono::minutes(5)};
+    bool filterScope{false};
+    dxf_order_scope_t scope{dxf_osc_composite};
+    std::wstring symbol{};// empty: all symbols
+
+    // Grammar: <count|min|max|sum|avg> <bid|ask|mid|spread|bidsize|asksize> [last <N>(s|m|h)]
+    //          [where scope = <composite|regional|aggregate|order>] [for <symbol>]
+    // e.g. "max spread last 5m where scope = regional"
+    static bool parse(const std::string &text, HistoryQuery &query, std::string &error) {
+        std::istringstream in{text};
+        std::vector<std::string> tokens{};
+        std::string token{};
+
+        while (in >> token) {
+            if (token != "=") {
+                tokens.push_back(token);
+            }
+        }
+
+        auto lower = [](std::string s) {
+            std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+
+            return s;
+        };
+
+        if (tokens.size() < 2) {
+            error = "expected <aggregate> <column>";
+
+            return false;
+        }
+
+        static const std::pair<const char *, QueryAggregate> aggregates[] = {
+            {"count", QueryAggregate::COUNT}, {"min", QueryAggregate::MIN}, {"max", QueryAggregate::MAX},
+            {"sum", QueryAggregate::SUM},     {"avg", QueryAggregate::AVG}};
+        static const std::pair<const char *, QueryColumn> columns[] = {
+            {"bid", QueryColumn::BID},       {"ask", QueryColumn::ASK},          {"mid", QueryColumn::MID},
+            {"spread", QueryColumn::SPREAD}, {"bidsize", QueryColumn::BID_SIZE}, {"asksize", QueryColumn::ASK_SIZE}};
+        static const std::pair<const char *, dxf_order_scope_t> scopes[] = {{"composite", dxf_osc_composite},
+                                                                            {"regional", dxf_osc_regional},
+                                                                            {"aggregate", dxf_osc_aggregate},
+                                                                            {"order", dxf_osc_order}};
+
+        auto match = [&](const std::string &word, const auto &table, auto &out) {
+            for (auto &entry : table) {
+                if (word == entry.first) {
+                    out = entry.second;
+
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        if (!match(lower(tokens[0]), aggregates, query.aggregate)) {
+            error = "unknown aggregate: " + tokens[0];
+
+            return false;
+        }
+
+        if (!match(lower(tokens[1]), columns, query.column)) {
+            error = "unknown column: " + tokens[1];
+
+            return false;
+        }
+
+        for (std::size_t i = 2; i < tokens.size(); i++) {
+            auto word = lower(tokens[i]);
+
+            if (word == "last" && i + 1 < tokens.size()) {
+                auto spec = lower(tokens[++i]);
+                char unit = spec.empty() ? 0 : spec.back();
+                long long value = std::atoll(spec.c_str());
+                long long factor = unit == 'h' ? 3600000 : unit == 'm' ? 60000 : unit == 's' ? 1000 : 0;
+
+                if (value <= 0 || factor == 0) {
+                    error = "bad window: " + spec;
+
+                    return false;
+                }
+
+                query.window = std::chrono::milliseconds(value * factor);
+            } else if (word == "where" && i + 2 < tokens.size() && lower(tokens[i + 1]) == "scope") {
+                if (!match(lower(tokens[i + 2]), scopes, query.scope)) {
+                    error = "unknown scope: " + tokens[i + 2];
+
+                    return false;
+                }
+
+                query.filterScope = true;
+                i += 2;
+            } else if (word == "for" && i + 1 < tokens.size()) {
+                auto &s = tokens[++i];
+
+                query.symbol.assign(s.begin(), s.end());
+            } else {
+                error = "unexpected token: " + tokens[i];
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+struct HistoryQueryRow {
+    std::wstring symbol{};
+    kernels::Aggregate aggregate{};
+};
+
+// Runs queries as columnar scans over snapshots of the per-symbol histories, grouped by symbol.
+class HistoryQueryEngine {
+    QuoteHistory &history;
+
+    // Scratch buffers reused between symbols.
+    QuoteColumns columns{};
+    std::vector<double> derived{};
+    std::vector<std::uint8_t> mask{};
+
+    const double *columnValues(QueryColumn column) {
+        auto n = columns.size();
+
+        derived.resize(n);
+
+        switch (column) {
+            case QueryColumn::BID:
+                return columns.bidPrice.data();
+            case QueryColumn::ASK:
+                return columns.askPrice.data();
+            case QueryColumn::BID_SIZE:
+                return columns.bidSize.data();
+            case QueryColumn::ASK_SIZE:
+                return columns.askSize.data();
+            case QueryColumn::MID:
+                kernels::combine(columns.askPrice.data(), 0.5, columns.bidPrice.data(), 0.5, n, derived.data());
+
+                return derived.data();
+            case QueryColumn::SPREAD:
+                kernels::combine(columns.askPrice.data(), 1.0, columns.bidPrice.data(), -1.0, n, derived.data());
+
+                return derived.data();
+        }
+
+        return columns.bidPrice.data();
+    }
+
+  public:
+    explicit HistoryQueryEngine(QuoteHistory &history) : history(history) {
+    }
+
+    std::vector<HistoryQueryRow> run(const HistoryQuery &query) {
+        std::vector<HistoryQueryRow> rows{};
+        auto &symbols = history.symbolTable();
+        auto from = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch() - query.window)
+                        .count();
+
+        auto scan = [&](std::uint32_t symbolId) {
+            if (!history.snapshot(symbolId, from, columns) || columns.size() == 0) {
+                return;
+            }
+
+            auto n = columns.size();
+            const std::uint8_t *selection = nullptr;
+
+            if (query.filterScope) {
+                mask.resize(n);
+                kernels::selectEqual(columns.scope.data(), n, static_cast<std::uint8_t>(query.scope), mask.data());
+                selection = mask.data();
+            }
+
+            auto aggregate = kernels::aggregate(columnValues(query.column), selection, n);
+
+            if (aggregate.count != 0) {
+                rows.push_back(HistoryQueryRow{symbols.name(symbolId), aggregate});
+            }
+        };
+
+        if (!query.symbol.empty()) {
+            auto symbolId = symbols.find(query.symbol);
+
+            if (symbolId != SymbolTable::INVALID_ID) {
+                scan(symbolId);
+            }
+        } else {
+            auto count = static_cast<std::uint32_t>(history.symbolCount());
+
+            for (std::uint32_t symbolId = 0; symbolId < count; symbolId++) {
+                scan(symbolId);
+            }
+        }
+
+        return rows;
+    }
+
+    static double value(QueryAggregate aggregate, const kernels::Aggregate &a) {
+        switch (aggregate) {
+            case QueryAggregate::COUNT:
+                return static_cast<double>(a.count);
+            case QueryAggregate::MIN:
+                return a.min;
+            case QueryAggregate::MAX:
+                return a.max;
+            case QueryAggregate::SUM:
+                return a.sum;
+            case QueryAggregate::AVG:
+                return a.count == 0 ? 0.0 : a.sum / static_cast<double>(a.count);
+        }
+
+        return 0.0;
+    }
+
+    // Runs the query and formats one line per symbol plus a total line.
+    std::string runToText(const HistoryQuery &query) {
+        auto rows = run(query);
+        kernels::Aggregate total{};
+        std::string text{};
+
+        for (auto &row : rows) {
+            total.merge(row.aggregate);
+            text += fmt::format("{} = {} (n = {})\n", std::string(row.symbol.begin(), row.symbol.end()),
+                                value(query.aggregate, row.aggregate), row.aggregate.count);
+        }
+
+        text += fmt::format("total = {} (n = {}, symbols = {})\n", value(query.aggregate, total), total.count,
+                            rows.size());
+
+        return text;
+    }
+};
@@ -0,0 +1,581 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "SymbolTable.hpp"
+
+// Read-only view of a whole file: memory-mapped where available, otherwise read into memory.
+class MappedFile {
+    const char *bytes{nullptr};
+    std::size_t length{0};
+    bool mapped{false};
+    std::string copy{};
+
+  public:
+    explicit MappedFile(const std::string &path) {
+#if defined(__unix__) || defined(__APPLE__)
+        auto fd = ::open(path.c_str(), O_RDONLY);
+
+        if (fd >= 0) {
+            struct stat info {};
+
+            if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+                auto *address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (address != MAP_FAILED) {
+                    bytes = static_cast<const char *>(address);
+                    length = static_cast<std::size_t>(info.st_size);
+                    mapped = true;
+                    ::madvise(address, length, MADV_SEQUENTIAL);
+                }
+            }
+
+            ::close(fd);
+
+            if (mapped) {
+                return;
+            }
+        }
+#endif
+        std::ifstream in{path, std::ios::binary};
+
+        if (in) {
+            copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            bytes = copy.data();
+            length = copy.size();
+        }
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapped) {
+            ::munmap(const_cast<char *>(bytes), length);
+        }
+#endif
+    }
+
+    const char *data() const {
+        return bytes;
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+};
+
+// Delimiter search for the IPF parser. Each function has an AVX2 or SSE2 body and a scalar tail.
+namespace scan {
+
+inline unsigned lowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+
+    _BitScanForward(&index, mask);
+
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// The first byte in [p, end) equal to `c`, or `end`.
+inline const char *find(const char *p, const char *end, char c) {
+#if defined(__AVX2__)
+    auto needle = _mm256_set1_epi8(c);
+
+    for (; p + 32 <= end; p += 32) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+
+        if (mask != 0) {
+            return p + lowestBit(mask);
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    auto needle = _mm_set1_epi8(c);
+
+    for (; p + 16 <= end; p += 16) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+
+        if (mask != 0) {
+            return p + lowestBit(mask);
+        }
+    }
+#endif
+
+    for (; p < end; p++) {
+        if (*p == c) {
+            return p;
+        }
+    }
+
+    return end;
+}
+
+}// namespace scan
+
+// Instrument profiles (dxFeed IPF files) reduced to what the subscriber needs: type, tick size and underlying per
+// symbol.
+//
+// An IPF file is CSV where "#TYPE::=FIELD,FIELD,..." lines define the columns of the records of TYPE that follow.
+// load() maps the file, splits it at line boundaries into one chunk per thread and parses in three passes: the
+// chunks are scanned in parallel for header lines, the headers in effect at each chunk start are resolved, and the
+// records are parsed in parallel. Symbols are then interned in file order under one lock. Quoted fields may not
+// contain line breaks; names are widened byte by byte, so they are expected to be ASCII.
+class InstrumentProfiles {
+  public:
+    struct Profile {
+        std::uint32_t symbolId{SymbolTable::INVALID_ID};
+        std::uint32_t underlyingId{SymbolTable::INVALID_ID};
+        std::uint16_t type{0};
+        double tickSize{0.0};
+    };
+
+  private:
+    struct Field {
+        const char *data{nullptr};
+        std::size_t size{0};
+    };
+
+    struct Layout {
+        std::string type{};
+        std::uint16_t typeId{0};
+        int symbol{-1};
+        int underlying{-1};
+        int priceIncrements{-1};
+    };
+
+    static constexpr std::uint32_t NONE = 0xFFFFFFFFu;
+
+    // Names are indices into Chunk::names.
+    struct Raw {
+        std::uint32_t symbol{NONE};
+        std::uint32_t underlying{NONE};
+        std::uint16_t type{0};
+        double tickSize{0.0};
+    };
+
+    struct Chunk {
+        const char *begin{nullptr};
+        const char *end{nullptr};
+        std::vector<const char *> headerLines{};
+        std::vector<Layout> layouts{};// in effect at the chunk start
+        std::vector<Raw> records{};
+        std::deque<std::string> unquoted{};// storage of fields that had escaped quotes
+        std::vector<std::wstring> names{};  // widened here, interned serially afterwards
+        std::size_t skipped{0};
+    };
+
+    SymbolTable &symbols;
+    std::vector<std::string> types{};
+    std::vector<Profile> profiles{};
+    std::vector<std::uint32_t> bySymbol{};// symbol id -> index in profiles
+    std::size_t skipped{0};
+
+    static const char *lineEnd(const char *p, const char *end) {
+        return scan::find(p, end, '\n');
+    }
+
+    // Splits a CSV line into fields. Quoted fields are unquoted into `storage` if they contain doubled quotes.
+    static void split(const char *p, const char *end, std::vector<Field> &fields, std::deque<std::string> &storage) {
+        fields.clear();
+
+        if (end > p && end[-1] == '\r') {
+            end--;
+        }
+
+        while (true) {
+            if (p < end && *p == '"') {
+                auto start = ++p;
+                bool escaped = false;
+
+                while (true) {
+                    p = scan::find(p, end, '"');
+
+                    if (p + 1 < end && p[1] == '"') {
+                        escaped = true;
+                        p += 2;
+
+                        continue;
+                    }
+
+                    break;
+                }
+
+                if (!escaped) {
+                    fields.push_back(Field{start, static_cast<std::size_t>(p - start)});
+                } else {
+                    storage.emplace_back();
+
+                    auto &text = storage.back();
+
+                    for (auto q = start; q < p; q++) {
+                        text += *q;
+
+                        if (*q == '"') {
+                            q++;
+                        }
+                    }
+
+                    fields.push_back(Field{text.data(), text.size()});
+                }
+
+                p = p < end ? scan::find(p + 1, end, ',') : end;
+            } else {
+                auto comma = scan::find(p, end, ',');
+
+                fields.push_back(Field{p, static_cast<std::size_t>(comma - p)});
+                p = comma;
+            }
+
+            if (p >= end) {
+                return;
+            }
+
+            p++;
+        }
+    }
+
+    static bool equals(const Field &f, const char *text, std::size_t n) {
+        return f.size == n && std::memcmp(f.data, text, n) == 0;
+    }
+
+    static bool equals(const Field &f, const char *text) {
+        return equals(f, text, std::strlen(text));
+    }
+
+    // The first number of PRICE_INCREMENTS ("0.01" or "0.0001 1; 0.01 ..."), 0 if there is none.
+    static double firstIncrement(const Field &f) {
+        char buffer[32];
+        auto n = std::min(f.size, sizeof(buffer) - 1);
+
+        std::memcpy(buffer, f.data, n);
+        buffer[n] = '\0';
+
+        return std::strtod(buffer, nullptr);
+    }
+
+    // Parses a "#TYPE::=FIELD,..." line into `layout`; returns false for other comment lines.
+    static bool parseHeader(const char *line, const char *end, Layout &layout, std::vector<Field> &fields,
+                            std::deque<std::string> &storage) {
+        std::string text{line + 1, end};
+        auto assign = text.find("::=");
+
+        if (assign == std::string::npos) {
+            return false;
+        }
+
+        layout = Layout{};
+        layout.type = text.substr(0, assign);
+        split(line + 1 + assign + 3, end, fields, storage);
+
+        for (std::size_t i = 0; i < fields.size(); i++) {
+            if (equals(fields[i], "SYMBOL")) {
+                layout.symbol = static_cast<int>(i);
+            } else if (equals(fields[i], "UNDERLYING")) {
+                layout.underlying = static_cast<int>(i);
+            } else if (equals(fields[i], "PRICE_INCREMENTS")) {
+                layout.priceIncrements = static_cast<int>(i);
+            }
+        }
+
+        return true;
+    }
+
+    // Replaces the layout of the same type, or adds it.
+    static void apply(std::vector<Layout> &layouts, const Layout &layout) {
+        for (auto &l : layouts) {
+            if (l.type == layout.type) {
+                l = layout;
+
+                return;
+            }
+        }
+
+        layouts.push_back(layout);
+    }
+
+    // Pass 1: the header lines of a chunk, i.e. lines starting with '#'.
+    static void findHeaders(Chunk &chunk) {
+        for (auto p = chunk.begin; p < chunk.end;) {
+            if (*p == '#') {
+                chunk.headerLines.push_back(p);
+            }
+
+            p = std::min(lineEnd(p, chunk.end) + 1, chunk.end);
+        }
+    }
+
+    std::uint16_t typeId(const std::string &type) {
+        for (std::size_t i = 0; i < types.size(); i++) {
+            if (types[i] == type) {
+                return static_cast<std::uint16_t>(i);
+            }
+        }
+
+        types.push_back(type);
+
+        return static_cast<std::uint16_t>(types.size() - 1);
+    }
+
+    // Pass 3: the records of a chunk, starting with the layouts in effect at its start.
+    static void parseRecords(Chunk &chunk, const std::vector<Layout> &allLayouts) {
+        std::vector<Layout> layouts = chunk.layouts;
+        std::vector<Field> fields{};
+        Layout header{};
+        Field lastUnderlying{};
+        std::uint32_t lastUnderlyingName{NONE};
+
+        for (auto p = chunk.begin; p < chunk.end;) {
+            auto end = lineEnd(p, chunk.end);
+
+            if (p == end || (end == p + 1 && *p == '\r')) {
+                // Empty line.
+            } else if (*p == '#') {
+                if (parseHeader(p, end, header, fields, chunk.unquoted)) {
+                    // Type ids were assigned in pass 2.
+                    for (auto &l : allLayouts) {
+                        if (l.type == header.type) {
+                            header.typeId = l.typeId;
+                        }
+                    }
+
+                    apply(layouts, header);
+                }
+            } else {
+                split(p, end, fields, chunk.unquoted);
+
+                const Layout *layout = nullptr;
+
+                for (auto &l : layouts) {
+                    if (equals(fields[0], l.type.data(), l.type.size())) {
+                        layout = &l;
+
+                        break;
+                    }
+                }
+
+                if (!layout || layout->symbol < 0 || static_cast<std::size_t>(layout->symbol) >= fields.size() ||
+                    fields[layout->symbol].size == 0) {
+                    chunk.skipped++;
+                } else {
+                    Raw raw{};
+
+                    raw.symbol = static_cast<std::uint32_t>(chunk.names.size());
+                    raw.type = layout->typeId;
+                    chunk.names.push_back(widen(fields[layout->symbol]));
+
+                    if (layout->underlying >= 0 && static_cast<std::size_t>(layout->underlying) < fields.size() &&
+                        fields[layout->underlying].size != 0) {
+                        auto &underlying = fields[layout->underlying];
+
+                        // Options of one underlying are usually listed together: widen it once.
+                        if (lastUnderlyingName == NONE ||
+                            !equals(underlying, lastUnderlying.data, lastUnderlying.size)) {
+                            lastUnderlying = underlying;
+                            lastUnderlyingName = static_cast<std::uint32_t>(chunk.names.size());
+                            chunk.names.push_back(widen(underlying));
+                        }
+
+                        raw.underlying = lastUnderlyingName;
+                    }
+
+                    if (layout->priceIncrements >= 0 &&
+                        static_cast<std::size_t>(layout->priceIncrements) < fields.size()) {
+                        raw.tickSize = firstIncrement(fields[layout->priceIncrements]);
+                    }
+
+                    chunk.records.push_back(raw);
+                }
+            }
+
+            p = std::min(end + 1, chunk.end);
+        }
+    }
+
+    template<typename F>
+    static void parallel(std::vector<Chunk> &chunks, F f) {
+        std::vector<std::thread> workers{};
+
+        for (std::size_t i = 1; i < chunks.size(); i++) {
+            workers.emplace_back(f, std::ref(chunks[i]));
+        }
+
+        if (!chunks.empty()) {
+            f(chunks[0]);
+        }
+
+        for (auto &w : workers) {
+            w.join();
+        }
+    }
+
+    static std::wstring widen(const Field &f) {
+        return std::wstring(f.data, f.data + f.size);
+    }
+
+  public:
+    explicit InstrumentProfiles(SymbolTable &symbols) : symbols(symbols) {
+    }
+
+    // Replaces the loaded profiles with those of the file. A symbol listed more than once keeps its last profile.
+    bool load(const std::string &path, std::string &error, std::size_t threads = std::thread::hardware_concurrency()) {
+        MappedFile file{path};
+
+        if (!file.data()) {
+            error = "Cannot read " + path;
+
+            return false;
+        }
+
+        // Chunks of at least 1 MiB, each ending after a line break.
+        constexpr std::size_t minChunk = 1 << 20;
+        auto count = std::max<std::size_t>(std::min(std::max<std::size_t>(threads, 1), file.size() / minChunk), 1);
+        auto *begin = file.data();
+        auto *end = begin + file.size();
+        std::vector<Chunk> chunks(count);
+
+        for (std::size_t i = 0; i < count; i++) {
+            auto split = i + 1 == count ? end : lineEnd(std::max(begin + file.size() / count * (i + 1), begin), end);
+
+            chunks[i].begin = i == 0 ? begin : chunks[i - 1].end;
+            chunks[i].end = std::max(split == end ? end : split + 1, chunks[i].begin);
+        }
+
+        parallel(chunks, findHeaders);
+
+        // Pass 2: the layouts in effect at each chunk start, and type ids in order of appearance.
+        std::vector<Layout> layouts{};
+        std::vector<Field> fields{};
+        std::deque<std::string> storage{};
+
+        types.clear();
+
+        for (auto &chunk : chunks) {
+            chunk.layouts = layouts;
+
+            for (auto line : chunk.headerLines) {
+                Layout layout{};
+
+                if (parseHeader(line, lineEnd(line, chunk.end), layout, fields, storage)) {
+                    layout.typeId = typeId(layout.type);
+                    apply(layouts, layout);
+                }
+            }
+        }
+
+        parallel(chunks, [&layouts](Chunk &chunk) {
+            parseRecords(chunk, layouts);
+        });
+
+        // Interned in file order, so symbol ids do not depend on the number of threads.
+        std::vector<std::vector<std::uint32_t>> ids(chunks.size());
+
+        skipped = 0;
+
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            skipped += chunks[i].skipped;
+            symbols.internAll(chunks[i].names, ids[i]);
+        }
+
+        profiles.clear();
+        bySymbol.assign(symbols.size(), std::uint32_t{SymbolTable::INVALID_ID});
+
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            for (auto &r : chunks[i].records) {
+                Profile profile{};
+
+                profile.symbolId = ids[i][r.symbol];
+                profile.underlyingId =
+                    r.underlying != NONE ? ids[i][r.underlying] : std::uint32_t{SymbolTable::INVALID_ID};
+                profile.type = r.type;
+                profile.tickSize = r.tickSize;
+
+                if (bySymbol[profile.symbolId] != SymbolTable::INVALID_ID) {
+                    profiles[bySymbol[profile.symbolId]] = profile;
+                } else {
+                    bySymbol[profile.symbolId] = static_cast<std::uint32_t>(profiles.size());
+                    profiles.push_back(profile);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // In file order.
+    const std::vector<Profile> &all() const {
+        return profiles;
+    }
+
+    const Profile *find(std::uint32_t symbolId) const {
+        return symbolId < bySymbol.size() && bySymbol[symbolId] != SymbolTable::INVALID_ID
+                   ? &profiles[bySymbol[symbolId]]
+                   : nullptr;
+    }
+
+    const std::string &typeName(std::uint16_t type) const {
+        return types[type];
+    }
+
+    const std::vector<std::string> &typeNames() const {
+        return types;
+    }
+
+    // Records without a known layout or a symbol.
+    std::size_t skippedCount() const {
+        return skipped;
+    }
+
+    // The symbols of the given types (all if `types` is empty), in file order.
+    std::vector<std::wstring> symbolsOf(const std::vector<std::string> &wanted) const {
+        std::vector<bool> selected(types.size(), wanted.empty());
+
+        for (std::size_t i = 0; i < types.size(); i++) {
+            selected[i] = selected[i] || std::find(wanted.begin(), wanted.end(), types[i]) != wanted.end();
+        }
+
+        std::vector<std::wstring> result{};
+
+        for (auto &p : profiles) {
+            if (selected[p.type]) {
+                result.push_back(symbols.name(p.symbolId));
+            }
+        }
+
+        return result;
+    }
+};
@@ -0,0 +1,271 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+// Fast LZ77 block codec in the spirit of LZ4: greedy matching through a single-entry hash table, byte-aligned sequences of
+// (literals, offset, match length). No entropy stage, so it runs at memory speed and still shrinks text logs 5-10x.
+//
+// A compressed stream is a sequence of independent blocks, each prefixed by a BlockHeader. Blocks do not reference
+// each other, so a file can be split at block boundaries and decompressed in parallel.
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace lz {
+
+constexpr std::uint32_t BLOCK_MAGIC = 0x5A4C5844u;// "DXLZ"
+constexpr std::uint32_t FLAG_STORED = 1u;         // payload is the raw block (it did not compress)
+
+#pragma pack(push, 1)
+
+struct BlockHeader {
+    std::uint32_t magic;
+    std::uint32_t rawSize;
+    std::uint32_t storedSize;
+    std::uint32_t flags;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(BlockHeader) == 16, "BlockHeader layout changed");
+
+namespace detail {
+
+constexpr int HASH_LOG = 14;
+constexpr std::size_t MIN_MATCH = 4;
+constexpr std::size_t LAST_LITERALS = 5;// the block always ends with literals
+constexpr std::size_t MATCH_LIMIT = 12; // no match may start closer than this to the end
+constexpr std::size_t MAX_OFFSET = 65535;
+
+inline std::uint32_t read32(const std::uint8_t *p) {
+    std::uint32_t v;
+
+    std::memcpy(&v, p, sizeof(v));
+
+    return v;
+}
+
+inline std::uint32_t hash(std::uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+inline std::uint8_t *writeLength(std::uint8_t *op, std::size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+
+    *op++ = static_cast<std::uint8_t>(length);
+
+    return op;
+}
+
+inline std::uint8_t *writeSequence(std::uint8_t *op, const std::uint8_t *literals, std::size_t literalLength,
+                                   std::size_t offset, std::size_t matchLength) {
+    auto *token = op++;
+    auto matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+
+    *token = static_cast<std::uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4 |
+                                       (matchCode >= 15 ? 15 : matchCode));
+
+    if (literalLength >= 15) {
+        op = writeLength(op, literalLength - 15);
+    }
+
+    if (literalLength != 0) {
+        std::memcpy(op, literals, literalLength);
+        op += literalLength;
+    }
+
+    if (matchLength != 0) {
+        *op++ = static_cast<std::uint8_t>(offset);
+        *op++ = static_cast<std::uint8_t>(offset >> 8);
+
+        if (matchCode >= 15) {
+            op = writeLength(op, matchCode - 15);
+        }
+    }
+
+    return op;
+}
+
+}// namespace detail
+
+inline std::size_t compressBound(std::size_t size) {
+    return size + size / 255 + 16;
+}
+
+// Compresses `size` bytes into `out`, which must hold compressBound(size) bytes. Returns the compressed size.
+inline std::size_t compress(const char *input, std::size_t size, char *out) {
+    using namespace detail;
+
+    auto *src = reinterpret_cast<const std::uint8_t *>(input);
+    auto *op = reinterpret_cast<std::uint8_t *>(out);
+    std::size_t anchor = 0;
+
+    if (size > MATCH_LIMIT) {
+        std::vector<std::uint32_t> table(std::size_t{1} << HASH_LOG, 0);
+        auto limit = size - MATCH_LIMIT;
+        std::size_t ip = 0;
+        std::size_t misses = 0;
+
+        while (ip < limit) {
+            auto sequence = read32(src + ip);
+            auto h = hash(sequence);
+            std::size_t ref = table[h];
+
+            table[h] = static_cast<std::uint32_t>(ip);
+
+            if (ref >= ip || ip - ref > MAX_OFFSET || read32(src + ref) != sequence) {
+                // Skip faster through incompressible data.
+                ip += 1 + (misses++ >> 6);
+
+                continue;
+            }
+
+            misses = 0;
+
+            auto length = MIN_MATCH;
+            auto matchEnd = size - LAST_LITERALS;
+
+            while (ip + length < matchEnd && src[ref + length] == src[ip + length]) {
+                length++;
+            }
+
+            op = writeSequence(op, src + anchor, ip - anchor, ip - ref, length);
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    op = writeSequence(op, src + anchor, size - anchor, 0, 0);
+
+    return static_cast<std::size_t>(op - reinterpret_cast<std::uint8_t *>(out));
+}
+
+// Decompresses one block into `out` of `capacity` bytes. Returns the decompressed size, or -1 on malformed input.
+inline long long decompress(const char *input, std::size_t size, char *out, std::size_t capacity) {
+    auto *ip = reinterpret_cast<const std::uint8_t *>(input);
+    auto *end = ip + size;
+    auto *op = reinterpret_cast<std::uint8_t *>(out);
+    auto *begin = op;
+    auto *limit = op + capacity;
+
+    auto readLength = [&](std::size_t &length) {
+        std::uint8_t b;
+
+        do {
+            if (ip >= end) {
+                return false;
+            }
+
+            b = *ip++;
+            length += b;
+        } while (b == 255);
+
+        return true;
+    };
+
+    while (ip < end) {
+        auto token = *ip++;
+        std::size_t literalLength = token >> 4;
+
+        if (literalLength == 15 && !readLength(literalLength)) {
+            return -1;
+        }
+
+        if (literalLength > static_cast<std::size_t>(end - ip) ||
+            literalLength > static_cast<std::size_t>(limit - op)) {
+            return -1;
+        }
+
+        std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return -1;
+        }
+
+        std::size_t offset = ip[0] | static_cast<std::size_t>(ip[1]) << 8;
+
+        ip += 2;
+
+        std::size_t matchLength = token & 15;
+
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return -1;
+        }
+
+        matchLength += detail::MIN_MATCH;
+
+        if (offset == 0 || offset > static_cast<std::size_t>(op - begin) ||
+            matchLength > static_cast<std::size_t>(limit - op)) {
+            return -1;
+        }
+
+        auto *match = op - offset;
+
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // Overlapping copy repeats the last `offset` bytes.
+            for (std::size_t i = 0; i < matchLength; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op - begin;
+}
+
+// Compresses `size` bytes into a framed block (header + payload) appended to `out`.
+inline void compressBlock(const char *data, std::size_t size, std::vector<char> &out) {
+    auto start = out.size();
+
+    out.resize(start + sizeof(BlockHeader) + compressBound(size));
+
+    auto *payload = out.data() + start + sizeof(BlockHeader);
+    auto compressed = compress(data, size, payload);
+    BlockHeader header{BLOCK_MAGIC, static_cast<std::uint32_t>(size), static_cast<std::uint32_t>(compressed), 0};
+
+    if (compressed >= size) {
+        if (size != 0) {
+            std::memcpy(payload, data, size);
+        }
+
+        header.storedSize = static_cast<std::uint32_t>(size);
+        header.flags = FLAG_STORED;
+    }
+
+    std::memcpy(out.data() + start, &header, sizeof(header));
+    out.resize(start + sizeof(BlockHeader) + header.storedSize);
+}
+
+// Decodes the payload of a framed block. Returns false if the block is corrupted.
+inline bool decompressBlock(const BlockHeader &header, const char *payload, std::vector<char> &out) {
+    out.resize(header.rawSize);
+
+    if (header.flags & FLAG_STORED) {
+        if (header.storedSize != header.rawSize) {
+            return false;
+        }
+
+        if (header.rawSize != 0) {
+            std::memcpy(out.data(), payload, header.rawSize);
+        }
+
+        return true;
+    }
+
+    return decompress(payload, header.storedSize, out.data(), out.size()) == static_cast<long long>(header.rawSize);
+}
+
+}// namespace lz
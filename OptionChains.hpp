@@ -0,0 +1,382 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <DXFeed.h>
+
+#include "BlackScholes.hpp"
+#include "SymbolTable.hpp"
+
+struct OptionContract {
+    std::wstring underlying{};
+    std::int64_t expiry{0};// ms since epoch
+    bool call{true};
+    double strike{0.0};
+};
+
+// Days since 1970-01-01 of a proleptic Gregorian date.
+inline std::int64_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+
+    auto era = (year >= 0 ? year : year - 399) / 400;
+    auto yearOfEra = year - era * 400;
+    auto dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return static_cast<std::int64_t>(era) * 146097 + dayOfEra - 719468;
+}
+
+// Parses a dxFeed option symbol ".<underlying><YYMMDD><C|P><strike>", e.g. ".AAPL240621C190" or ".SPY240621P512.5".
+// Options expire at the US close, taken as 21:00 UTC.
+inline bool parseOptionSymbol(const std::wstring &symbol, OptionContract &out) {
+    if (symbol.size() < 10 || symbol[0] != L'.') {
+        return false;
+    }
+
+    auto p = symbol.size();
+
+    while (p > 0 && ((symbol[p - 1] >= L'0' && symbol[p - 1] <= L'9') || symbol[p - 1] == L'.')) {
+        p--;
+    }
+
+    if (p == symbol.size() || p < 8 || (symbol[p - 1] != L'C' && symbol[p - 1] != L'P')) {
+        return false;
+    }
+
+    auto strikeText = std::string(symbol.begin() + static_cast<std::ptrdiff_t>(p), symbol.end());
+    auto datePos = p - 7;
+
+    for (auto i = datePos; i < datePos + 6; i++) {
+        if (symbol[i] < L'0' || symbol[i] > L'9') {
+            return false;
+        }
+    }
+
+    auto digits = [&](std::size_t at) {
+        return (symbol[at] - L'0') * 10 + (symbol[at + 1] - L'0');
+    };
+
+    out.underlying = symbol.substr(1, datePos - 1);
+    out.expiry = (daysFromCivil(2000 + digits(datePos), digits(datePos + 2), digits(datePos + 4)) * 24 + 21) * 3600000;
+    out.call = symbol[p - 1] == L'C';
+    out.strike = std::strtod(strikeText.c_str(), nullptr);
+
+    return !out.underlying.empty() && out.strike > 0.0;
+}
+
+// Greeks of one option as of the last recompute.
+struct OptionGreeks {
+    std::wstring symbol{};
+    bool call{true};
+    double strike{0.0};
+    std::int64_t expiry{0};
+    double bid{0.0};
+    double ask{0.0};
+    double volatility{0.0};
+    double delta{0.0};
+    double gamma{0.0};
+    double vega{0.0};
+    double theta{0.0};
+};
+
+// Option chains grouped by underlying, each kept as parallel arrays. A quote of an option marks that option dirty;
+// a quote of the underlying marks the whole chain dirty. Dirty options are gathered into one batch and solved with
+// the vectorized Black-Scholes kernel, so a full chain reprices in a few passes over contiguous memory.
+class OptionChains {
+    struct Chain {
+        std::uint32_t underlyingId{SymbolTable::INVALID_ID};
+        double spot{std::numeric_limits<double>::quiet_NaN()};
+
+        std::vector<std::uint32_t> symbolIds{};
+        std::vector<double> strike{};
+        std::vector<double> logStrike{};
+        std::vector<double> expiry{};// ms since epoch
+        std::vector<double> sign{};  // +1 call, -1 put
+        std::vector<double> bid{};
+        std::vector<double> ask{};
+
+        std::vector<double> volatility{};
+        std::vector<double> delta{};
+        std::vector<double> gamma{};
+        std::vector<double> vega{};
+        std::vector<double> theta{};
+        std::vector<std::uint8_t> dirty{};
+    };
+
+    // Where a symbol lives: the chain index and the option index, or NO_OPTION for the underlying itself.
+    struct Ref {
+        static constexpr std::int32_t NO_OPTION = -1;
+
+        std::int32_t chain{-1};
+        std::int32_t option{NO_OPTION};
+    };
+
+    SymbolTable &symbols;
+    double rate;
+    std::mutex mutex{};
+    std::vector<Chain> chains{};
+    std::vector<Ref> refs{};
+    blackscholes::Batch batch{};
+    std::vector<std::size_t> batchOptions{};
+
+    static double nowMillis() {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       std::chrono::system_clock::now().time_since_epoch())
+                                       .count());
+    }
+
+    static double mid(double bid, double ask) {
+        if (bid > 0.0 && ask > 0.0) {
+            return (bid + ask) / 2.0;
+        }
+
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    Ref &ref(std::uint32_t symbolId) {
+        if (symbolId >= refs.size()) {
+            refs.resize(symbolId + 1);
+        }
+
+        return refs[symbolId];
+    }
+
+    void recompute(Chain &c) {
+        constexpr double MILLIS_PER_YEAR = 365.0 * 24 * 3600 * 1000;
+
+        batchOptions.clear();
+
+        for (std::size_t i = 0; i < c.dirty.size(); i++) {
+            if (c.dirty[i]) {
+                c.dirty[i] = 0;
+                batchOptions.push_back(i);
+            }
+        }
+
+        if (batchOptions.empty() || !(c.spot > 0.0)) {
+            return;
+        }
+
+        auto now = nowMillis();
+        auto logSpot = std::log(c.spot);
+
+        batch.resize(batchOptions.size());
+
+        for (std::size_t j = 0; j < batchOptions.size(); j++) {
+            auto i = batchOptions[j];
+
+            batch.spot[j] = c.spot;
+            batch.strike[j] = c.strike[i];
+            batch.logMoneyness[j] = logSpot - c.logStrike[i];
+            batch.time[j] = (c.expiry[i] - now) / MILLIS_PER_YEAR;
+            batch.sign[j] = c.sign[i];
+            batch.price[j] = mid(c.bid[i], c.ask[i]);
+        }
+
+        blackscholes::solve(batch, rate);
+
+        for (std::size_t j = 0; j < batchOptions.size(); j++) {
+            auto i = batchOptions[j];
+
+            c.volatility[i] = batch.volatility[j];
+            c.delta[i] = batch.delta[j];
+            c.gamma[i] = batch.gamma[j];
+            c.vega[i] = batch.vega[j];
+            c.theta[i] = batch.theta[j];
+        }
+    }
+
+  public:
+    OptionChains(SymbolTable &symbols, double rate) : symbols(symbols), rate(rate) {
+    }
+
+    // Adds an option to the chain of its underlying. Returns false if the symbol is not an option symbol.
+    bool addOption(const std::wstring &symbol) {
+        OptionContract contract{};
+
+        if (!parseOptionSymbol(symbol, contract)) {
+            return false;
+        }
+
+        auto optionId = symbols.intern(symbol).first;
+        auto underlyingId = symbols.intern(contract.underlying).first;
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (ref(optionId).chain >= 0) {
+            return true;
+        }
+
+        auto &underlyingRef = ref(underlyingId);
+
+        if (underlyingRef.chain < 0) {
+            underlyingRef.chain = static_cast<std::int32_t>(chains.size());
+            chains.emplace_back();
+            chains.back().underlyingId = underlyingId;
+        }
+
+        auto chainIndex = underlyingRef.chain;
+        auto &c = chains[chainIndex];
+        auto nan = std::numeric_limits<double>::quiet_NaN();
+
+        ref(optionId) = Ref{chainIndex, static_cast<std::int32_t>(c.symbolIds.size())};
+        c.symbolIds.push_back(optionId);
+        c.strike.push_back(contract.strike);
+        c.logStrike.push_back(std::log(contract.strike));
+        c.expiry.push_back(static_cast<double>(contract.expiry));
+        c.sign.push_back(contract.call ? 1.0 : -1.0);
+        c.bid.push_back(nan);
+        c.ask.push_back(nan);
+
+        for (auto *column : {&c.volatility, &c.delta, &c.gamma, &c.vega, &c.theta}) {
+            column->push_back(nan);
+        }
+
+        c.dirty.push_back(0);
+
+        return true;
+    }
+
+    // Options and underlyings to subscribe quotes for.
+    std::vector<std::wstring> subscriptionSymbols() {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::vector<std::wstring> result{};
+
+        for (auto &c : chains) {
+            result.push_back(symbols.name(c.underlyingId));
+
+            for (auto id : c.symbolIds) {
+                result.push_back(symbols.name(id));
+            }
+        }
+
+        return result;
+    }
+
+    // Applies the last quote of the batch and reprices the affected options. Repeated deliveries of an unchanged
+    // quote (one per subscription) do not trigger a recompute.
+    void onQuotes(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count) {
+        onQuotes(symbols.find(symbolName), quotes, count);
+    }
+
+    // `symbolId` is an id of the chains' symbol table, which the listener has already interned.
+    void onQuotes(std::uint32_t symbolId, const dxf_quote_t *quotes, int count) {
+        if (count <= 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId >= refs.size() || refs[symbolId].chain < 0) {
+            return;
+        }
+
+        auto r = refs[symbolId];
+        auto &c = chains[r.chain];
+        auto &q = quotes[count - 1];
+
+        if (r.option == Ref::NO_OPTION) {
+            auto spot = mid(q.bid_price, q.ask_price);
+
+            if (!(spot > 0.0) || spot == c.spot) {
+                return;
+            }
+
+            c.spot = spot;
+            std::fill(c.dirty.begin(), c.dirty.end(), 1);
+        } else {
+            if (q.bid_price == c.bid[r.option] && q.ask_price == c.ask[r.option]) {
+                return;
+            }
+
+            c.bid[r.option] = q.bid_price;
+            c.ask[r.option] = q.ask_price;
+            c.dirty[r.option] = 1;
+        }
+
+        recompute(c);
+    }
+
+    // Copies the chain of `underlying` ordered as added. Returns false if there is no such chain.
+    bool snapshot(const std::wstring &underlying, double &spot, std::vector<OptionGreeks> &out) {
+        auto underlyingId = symbols.find(underlying);
+        std::lock_guard<std::mutex> lock{mutex};
+
+        out.clear();
+
+        if (underlyingId >= refs.size() || refs[underlyingId].chain < 0) {
+            return false;
+        }
+
+        auto &c = chains[refs[underlyingId].chain];
+
+        spot = c.spot;
+
+        for (std::size_t i = 0; i < c.symbolIds.size(); i++) {
+            OptionGreeks g{};
+
+            g.symbol = symbols.name(c.symbolIds[i]);
+            g.call = c.sign[i] > 0.0;
+            g.strike = c.strike[i];
+            g.expiry = static_cast<std::int64_t>(c.expiry[i]);
+            g.bid = c.bid[i];
+            g.ask = c.ask[i];
+            g.volatility = c.volatility[i];
+            g.delta = c.delta[i];
+            g.gamma = c.gamma[i];
+            g.vega = c.vega[i];
+            g.theta = c.theta[i];
+            out.push_back(std::move(g));
+        }
+
+        return true;
+    }
+
+    std::vector<std::wstring> underlyings() {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::vector<std::wstring> result{};
+
+        for (auto &c : chains) {
+            result.push_back(symbols.name(c.underlyingId));
+        }
+
+        return result;
+    }
+
+    std::string toText() {
+        std::string text{};
+        std::vector<OptionGreeks> options{};
+
+        for (auto &underlying : underlyings()) {
+            double spot = 0.0;
+
+            if (!snapshot(underlying, spot, options)) {
+                continue;
+            }
+
+            text += fmt::format("Chain {} spot = {:.4f}, {} options\n", std::string(underlying.begin(), underlying.end()),
+                                spot, options.size());
+
+            for (auto &g : options) {
+                text += fmt::format("  {:<24} {} {:>10.2f} bid = {:<10g} ask = {:<10g} iv = {:7.4f} delta = {:7.4f} "
+                                    "gamma = {:8.5f} vega = {:8.4f} theta = {:8.4f}\n",
+                                    std::string(g.symbol.begin(), g.symbol.end()), g.call ? 'C' : 'P', g.strike, g.bid,
+                                    g.ask, g.volatility, g.delta, g.gamma, g.vega, g.theta);
+            }
+        }
+
+        return text;
+    }
+};
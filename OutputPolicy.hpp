@@ -0,0 +1,221 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "SymbolTable.hpp"
+
+enum class OutputPolicyKind { ALL,
+                              SAMPLE,
+                              RATE_LIMIT,
+                              ON_CHANGE };
+
+struct OutputPolicyConfig {
+    OutputPolicyKind kind{OutputPolicyKind::ALL};
+    // SAMPLE: print every N-th event of a symbol.
+    std::uint64_t everyN{1};
+    // RATE_LIMIT: print at most K events of a symbol per second.
+    std::uint64_t maxPerSecond{0};
+    // How often the aggregate line with suppressed counts is produced. Zero disables it.
+    std::chrono::seconds summaryPeriod{10};
+};
+
+// Decides which events of a subscription are printed. Suppressed events are still counted and reported in a
+// periodic summary, so the cost of console output is bounded by the policy and not by the feed rate. The policy
+// applies to each event type of a symbol on its own: trade prices are not compared with quotes, nor do trades use up
+// the rate limit of quotes.
+class OutputPolicy {
+    using Clock = std::chrono::steady_clock;
+
+    struct StreamState {
+        int eventType{0};
+        std::uint64_t seen{0};// never reset, so sampling keeps its phase across summary periods
+        std::uint64_t printed{0};   // in the current summary period
+        std::uint64_t suppressed{0};
+        Clock::time_point windowStart{};
+        std::uint64_t windowPrinted{0};
+        double lastBid{0.0};
+        double lastAsk{0.0};
+        bool hasLast{false};
+    };
+
+    std::mutex mutex{};
+    OutputPolicyConfig config{};
+    std::vector<std::vector<StreamState>> states{};// per symbol, one per event type seen
+    Clock::time_point periodStart{Clock::now()};
+
+    StreamState &state(std::uint32_t symbolId, int eventType) {
+        if (symbolId >= states.size()) {
+            states.resize(symbolId + 1);
+        }
+
+        auto &streams = states[symbolId];
+
+        for (auto &s : streams) {
+            if (s.eventType == eventType) {
+                return s;
+            }
+        }
+
+        streams.emplace_back();
+        streams.back().eventType = eventType;
+
+        return streams.back();
+    }
+
+    bool decide(StreamState &s, double bid, double ask, Clock::time_point now) const {
+        switch (config.kind) {
+            case OutputPolicyKind::ALL:
+                return true;
+            case OutputPolicyKind::SAMPLE:
+                return config.everyN <= 1 || (s.seen - 1) % config.everyN == 0;
+            case OutputPolicyKind::RATE_LIMIT:
+                if (now - s.windowStart >= std::chrono::seconds(1)) {
+                    s.windowStart = now;
+                    s.windowPrinted = 0;
+                }
+
+                return s.windowPrinted < config.maxPerSecond;
+            case OutputPolicyKind::ON_CHANGE:
+                return !s.hasLast || s.lastBid != bid || s.lastAsk != ask;
+        }
+
+        return true;
+    }
+
+  public:
+    void configure(const OutputPolicyConfig &newConfig) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        config = newConfig;
+    }
+
+    OutputPolicyConfig currentConfig() {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        return config;
+    }
+
+    // Returns true if the event should be printed. Every call is counted, printed or not. A trade passes its price
+    // as both `bid` and `ask`.
+    bool admit(std::uint32_t symbolId, int eventType, double bid, double ask) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto now = Clock::now();
+        auto &s = state(symbolId, eventType);
+
+        s.seen++;
+
+        bool print = decide(s, bid, ask, now);
+
+        s.lastBid = bid;
+        s.lastAsk = ask;
+        s.hasLast = true;
+
+        if (print) {
+            s.printed++;
+            s.windowPrinted++;
+        } else {
+            s.suppressed++;
+        }
+
+        return print;
+    }
+
+    // If the summary period has elapsed, or at the `last` call, fills `line` with the aggregate for the period,
+    // resets the counters and returns true. A period without events has no summary.
+    bool takeSummary(std::string &line, const SymbolTable &symbols, bool last = false) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto now = Clock::now();
+
+        if (config.summaryPeriod.count() == 0 || (!last && now - periodStart < config.summaryPeriod)) {
+            return false;
+        }
+
+        std::uint64_t printed = 0;
+        std::uint64_t suppressed = 0;
+        std::string details{};
+        std::size_t listed = 0;
+        constexpr std::size_t maxListed = 8;
+
+        for (std::uint32_t id = 0; id < states.size(); id++) {
+            std::uint64_t symbolPrinted = 0;
+            std::uint64_t symbolSuppressed = 0;
+
+            for (auto &s : states[id]) {
+                symbolPrinted += s.printed;
+                symbolSuppressed += s.suppressed;
+                s.printed = 0;
+                s.suppressed = 0;
+            }
+
+            printed += symbolPrinted;
+            suppressed += symbolSuppressed;
+
+            if (symbolSuppressed != 0 && listed < maxListed) {
+                auto name = symbols.name(id);
+
+                details += fmt::format("{}{}: {}/{}", listed == 0 ? "" : ", ", std::string(name.begin(), name.end()),
+                                       symbolPrinted, symbolSuppressed);
+                listed++;
+            }
+        }
+
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now - periodStart).count();
+
+        periodStart = now;
+
+        if (printed == 0 && suppressed == 0) {
+            return false;
+        }
+
+        line = fmt::format("Summary[{}s]: printed = {}, suppressed = {}", seconds, printed, suppressed);
+
+        if (!details.empty()) {
+            line += fmt::format(" ({}{})", details, listed == maxListed ? ", ..." : "");
+        }
+
+        return true;
+    }
+};
+
+// Parses "all", "sample:N", "rate:K" or "change". Returns false on malformed input.
+inline bool parseOutputPolicy(const std::string &text, OutputPolicyConfig &config) {
+    auto colon = text.find(':');
+    auto name = text.substr(0, colon);
+    std::uint64_t value = 0;
+
+    if (colon != std::string::npos) {
+        try {
+            value = std::stoull(text.substr(colon + 1));
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    if (name == "all") {
+        config.kind = OutputPolicyKind::ALL;
+    } else if (name == "sample" && value > 0) {
+        config.kind = OutputPolicyKind::SAMPLE;
+        config.everyN = value;
+    } else if (name == "rate" && value > 0) {
+        config.kind = OutputPolicyKind::RATE_LIMIT;
+        config.maxPerSecond = value;
+    } else if (name == "change") {
+        config.kind = OutputPolicyKind::ON_CHANGE;
+    } else {
+        return false;
+    }
+
+    return true;
+}
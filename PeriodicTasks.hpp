@@ -0,0 +1,63 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs tasks (reports, flushes) periodically, each on a thread of its own, until stop(). The threads wait on a
+// condition variable instead of sleeping, so stop() wakes them at once and joins them; a task already running is
+// finished first. The owner stops the tasks before it destroys anything they use.
+class PeriodicTasks {
+    std::mutex mutex{};
+    std::condition_variable wakeup{};
+    bool stopping{false};
+    std::vector<std::thread> threads{};
+
+    void run(const std::function<void()> &task, std::chrono::milliseconds period) {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        while (!wakeup.wait_for(lock, period, [this] {
+            return stopping;
+        })) {
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+  public:
+    // Runs `task` every `period`, the first time one period from now.
+    void add(std::function<void()> task, std::chrono::milliseconds period) {
+        threads.emplace_back([this, task, period] {
+            run(task, period);
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            stopping = true;
+        }
+
+        wakeup.notify_all();
+
+        for (auto &t : threads) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+
+        threads.clear();
+    }
+
+    ~PeriodicTasks() {
+        stop();
+    }
+};
@@ -0,0 +1,108 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <fmt/format.h>
+
+// Call counts and timing of one pipeline stage. Updated with relaxed atomics, so listeners of several connections may
+// share a pipeline.
+class StageStats {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> stopped{0};
+    std::atomic<std::uint64_t> totalNanos{0};
+    std::atomic<std::uint64_t> maxNanos{0};
+
+  public:
+    void add(std::uint64_t nanos, bool passed) {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+
+        if (!passed) {
+            stopped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto max = maxNanos.load(std::memory_order_relaxed);
+
+        while (nanos > max && !maxNanos.compare_exchange_weak(max, nanos, std::memory_order_relaxed)) {
+        }
+    }
+
+    // "12000 calls, avg 85 ns, max 14 us, 3 stopped"
+    std::string toText() const {
+        auto n = calls.load(std::memory_order_relaxed);
+
+        return fmt::format("{} calls, avg {} ns, max {} us, {} stopped", n,
+                           n == 0 ? 0 : totalNanos.load(std::memory_order_relaxed) / n,
+                           maxNanos.load(std::memory_order_relaxed) / 1000, stopped.load(std::memory_order_relaxed));
+    }
+};
+
+// A chain of processing stages composed at compile time: Pipeline<A, B, C> runs A, then B, then C on each item, and
+// since every stage type is known, the calls between them are inlined. A stage is a type with
+// `bool operator()(Item &)`, returning false to stop the item there (a filter), and `static const char *name()`.
+//
+// Each stage is timed on its own, excluding the stages after it. The pipeline has no queues: a stage that hands the
+// item to another thread (the dispatch lanes or the event ring) is the thread boundary and the last stage of the chain.
+// The consumers past that boundary are pipelines of their own, one per consumer thread.
+template<typename... Stages>
+class Pipeline;
+
+template<>
+class Pipeline<> {
+  public:
+    template<typename Item>
+    bool operator()(Item &) {
+        return true;
+    }
+
+    void report(std::string &, const std::string & = std::string{}) const {
+    }
+};
+
+template<typename Stage, typename... Rest>
+class Pipeline<Stage, Rest...> {
+    using Clock = std::chrono::steady_clock;
+
+    Stage stage;
+    StageStats stats{};
+    Pipeline<Rest...> rest;
+
+  public:
+    Pipeline() = default;
+
+    explicit Pipeline(Stage first, Rest... others) : stage(std::move(first)), rest(std::move(others)...) {
+    }
+
+    template<typename Item>
+    bool operator()(Item &item) {
+        auto started = Clock::now();
+        auto passed = stage(item);
+
+        stats.add(static_cast<std::uint64_t>(
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count()),
+                  passed);
+
+        return passed && rest(item);
+    }
+
+    // One line per stage, in pipeline order; `prefix` precedes the stage names.
+    void report(std::string &text, const std::string &prefix = std::string{}) const {
+        text += fmt::format("Stage {}{}: {}\n", prefix, Stage::name(), stats.toText());
+        rest.report(text, prefix);
+    }
+
+    std::string report() const {
+        std::string text{};
+
+        report(text);
+
+        return text;
+    }
+};
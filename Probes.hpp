@@ -0,0 +1,42 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+// USDT tracepoints of provider `supdxfd`, for bpftrace, perf and other eBPF tools. With <sys/sdt.h> (systemtap-sdt-dev)
+// each probe compiles to a single nop plus an ELF note describing its arguments; a tracer attaching to the probe
+// patches the nop, so an unattached probe costs nothing but the evaluation of its arguments, which are all values
+// already at hand. Without the header, or with SUPDXFD_NO_USDT defined, the probes compile to nothing.
+//
+// Probes and their arguments:
+//   listener__entry, listener__return     subscription id, event type, event count
+//   subscription__create                  subscription id, handle
+//   subscription__symbols                 subscription id, 1 to add or 0 to remove, symbol count
+//   subscription__close                   subscription id, handle
+//   lane__enqueue, lane__dequeue          lane name, queue depth
+//   ring__publish                         sequence
+//   ring__consume                         consumer name, first sequence, last sequence
+//   sink__flush                           sink kind, bytes handed to the OS
+
+#if !defined(SUPDXFD_NO_USDT) && defined(__linux__) && defined(__has_include)
+#    if __has_include(<sys/sdt.h>)
+#        include <sys/sdt.h>
+#        define SUPDXFD_HAVE_USDT 1
+#    endif
+#endif
+
+#ifdef SUPDXFD_HAVE_USDT
+#    define SUPDXFD_PROBE1(name, a1) DTRACE_PROBE1(supdxfd, name, a1)
+#    define SUPDXFD_PROBE2(name, a1, a2) DTRACE_PROBE2(supdxfd, name, a1, a2)
+#    define SUPDXFD_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(supdxfd, name, a1, a2, a3)
+#else
+#    define SUPDXFD_PROBE1(name, a1) \
+        do {                         \
+        } while (0)
+#    define SUPDXFD_PROBE2(name, a1, a2) \
+        do {                             \
+        } while (0)
+#    define SUPDXFD_PROBE3(name, a1, a2, a3) \
+        do {                                 \
+        } while (0)
+#endif
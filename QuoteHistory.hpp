@@ -0,0 +1,258 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "SymbolTable.hpp"
+
+// Columnar copy of a part of a symbol history. Columns are parallel arrays of the same length.
+struct QuoteColumns {
+    std::vector<std::int64_t> receiveTime{};// ms since epoch, non-decreasing
+    std::vector<std::int64_t> eventTime{};
+    std::vector<double> bidPrice{};
+    std::vector<double> askPrice{};
+    std::vector<double> bidSize{};
+    std::vector<double> askSize{};
+    std::vector<std::uint8_t> scope{};
+    std::vector<std::uint16_t> bidExchangeCode{};
+    std::vector<std::uint16_t> askExchangeCode{};
+
+    std::size_t size() const {
+        return receiveTime.size();
+    }
+
+    void resize(std::size_t n) {
+        receiveTime.resize(n);
+        eventTime.resize(n);
+        bidPrice.resize(n);
+        askPrice.resize(n);
+        bidSize.resize(n);
+        askSize.resize(n);
+        scope.resize(n);
+        bidExchangeCode.resize(n);
+        askExchangeCode.resize(n);
+    }
+};
+
+// One history entry.
+struct QuoteSample {
+    std::int64_t receiveTime{0};
+    std::int64_t eventTime{0};
+    double bidPrice{0.0};
+    double askPrice{0.0};
+    double bidSize{0.0};
+    double askSize{0.0};
+    std::uint8_t scope{0};
+};
+
+// Bounded per-symbol quote history stored as column rings. A ring grows with the quotes of its symbol up to the
+// capacity, so quiet symbols hold little memory. Appends and snapshots lock only the symbol's own history, and a
+// snapshot copies just the requested time range, so readers never stall ingestion for longer than a memcpy.
+class QuoteHistory {
+    struct SymbolHistory {
+        std::mutex mutex{};
+        QuoteColumns ring{};
+        std::size_t head{0};// index of the oldest entry
+        std::size_t count{0};
+        std::int32_t lastSequence{0};
+        std::int64_t lastEventTime{-1};
+
+        std::size_t slot(std::size_t i) const {
+            return (head + i) % ring.size();
+        }
+    };
+
+    std::size_t capacity;
+    SymbolTable &symbols;
+    std::mutex indexMutex{};
+    std::vector<std::unique_ptr<SymbolHistory>> histories{};
+
+    static std::int64_t nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    SymbolHistory *lookup(std::uint32_t symbolId, bool create) {
+        std::lock_guard<std::mutex> lock{indexMutex};
+
+        if (symbolId >= histories.size()) {
+            if (!create) {
+                return nullptr;
+            }
+
+            histories.resize(symbolId + 1);
+        }
+
+        if (!histories[symbolId] && create) {
+            histories[symbolId].reset(new SymbolHistory{});
+        }
+
+        return histories[symbolId].get();
+    }
+
+  public:
+    QuoteHistory(std::size_t capacity, SymbolTable &symbols) : capacity(std::max<std::size_t>(capacity, 1)), symbols(symbols) {
+    }
+
+    SymbolTable &symbolTable() const {
+        return symbols;
+    }
+
+    std::size_t symbolCount() {
+        std::lock_guard<std::mutex> lock{indexMutex};
+
+        return histories.size();
+    }
+
+    void append(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count) {
+        append(symbols.intern(symbolName).first, quotes, count);
+    }
+
+    // `symbolId` is an id of symbolTable().
+    void append(std::uint32_t symbolId, const dxf_quote_t *quotes, int count) {
+        auto *h = lookup(symbolId, true);
+        std::lock_guard<std::mutex> lock{h->mutex};
+        auto receiveTime = nowMillis();
+
+        for (int i = 0; i < count; i++) {
+            auto &q = quotes[i];
+
+            // The same quote is delivered to every subscription of the symbol, store it once.
+            if (q.sequence == h->lastSequence && q.time == h->lastEventTime) {
+                continue;
+            }
+
+            std::size_t at;
+
+            if (h->count < capacity) {
+                // The head stays at slot 0 until the ring is at capacity, so growing keeps the order.
+                if (h->count == h->ring.size()) {
+                    h->ring.resize(std::min(capacity, std::max<std::size_t>(h->count * 2, 16)));
+                }
+
+                at = h->slot(h->count);
+                h->count++;
+            } else {
+                at = h->head;
+                h->head = (h->head + 1) % capacity;
+            }
+
+            auto &r = h->ring;
+            auto previous = h->count > 1 ? r.receiveTime[h->slot(h->count - 2)] : receiveTime;
+
+            r.receiveTime[at] = std::max(receiveTime, previous);
+            r.eventTime[at] = q.time;
+            r.bidPrice[at] = q.bid_price;
+            r.askPrice[at] = q.ask_price;
+            r.bidSize[at] = q.bid_size;
+            r.askSize[at] = q.ask_size;
+            r.scope[at] = static_cast<std::uint8_t>(q.scope);
+            r.bidExchangeCode[at] = static_cast<std::uint16_t>(q.bid_exchange_code);
+            r.askExchangeCode[at] = static_cast<std::uint16_t>(q.ask_exchange_code);
+            h->lastSequence = q.sequence;
+            h->lastEventTime = q.time;
+        }
+    }
+
+    // Finds the latest quote with event time <= `eventTime` (the prevailing quote at that moment). Quotes of a symbol
+    // arrive in event time order, so this is a binary search over the ring. Returns false if there is none.
+    bool asOf(std::uint32_t symbolId, std::int64_t eventTime, QuoteSample &out) {
+        auto *h = lookup(symbolId, false);
+
+        if (!h) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock{h->mutex};
+        auto &r = h->ring;
+        std::size_t lo = 0;
+        std::size_t hi = h->count;
+
+        while (lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+
+            if (r.eventTime[h->slot(mid)] <= eventTime) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if (lo == 0) {
+            return false;
+        }
+
+        auto at = h->slot(lo - 1);
+
+        out.receiveTime = r.receiveTime[at];
+        out.eventTime = r.eventTime[at];
+        out.bidPrice = r.bidPrice[at];
+        out.askPrice = r.askPrice[at];
+        out.bidSize = r.bidSize[at];
+        out.askSize = r.askSize[at];
+        out.scope = r.scope[at];
+
+        return true;
+    }
+
+    // Copies entries received at or after `fromReceiveTime` into `out`. Returns false if the symbol has no history.
+    bool snapshot(std::uint32_t symbolId, std::int64_t fromReceiveTime, QuoteColumns &out) {
+        auto *h = lookup(symbolId, false);
+
+        if (!h) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock{h->mutex};
+        auto &r = h->ring;
+
+        // receiveTime is non-decreasing in ring order, so the window start is found by binary search.
+        std::size_t lo = 0;
+        std::size_t hi = h->count;
+
+        while (lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+
+            if (r.receiveTime[h->slot(mid)] < fromReceiveTime) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        auto n = h->count - lo;
+
+        out.resize(n);
+
+        // At most two contiguous segments because of the wrap-around.
+        std::size_t copied = 0;
+
+        while (copied < n) {
+            auto from = h->slot(lo + copied);
+            auto len = std::min(n - copied, r.size() - from);
+
+            std::copy_n(&r.receiveTime[from], len, &out.receiveTime[copied]);
+            std::copy_n(&r.eventTime[from], len, &out.eventTime[copied]);
+            std::copy_n(&r.bidPrice[from], len, &out.bidPrice[copied]);
+            std::copy_n(&r.askPrice[from], len, &out.askPrice[copied]);
+            std::copy_n(&r.bidSize[from], len, &out.bidSize[copied]);
+            std::copy_n(&r.askSize[from], len, &out.askSize[copied]);
+            std::copy_n(&r.scope[from], len, &out.scope[copied]);
+            std::copy_n(&r.bidExchangeCode[from], len, &out.bidExchangeCode[copied]);
+            std::copy_n(&r.askExchangeCode[from], len, &out.askExchangeCode[copied]);
+            copied += len;
+        }
+
+        return true;
+    }
+};
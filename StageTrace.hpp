@@ -0,0 +1,160 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#    define SUPDXFD_HAVE_RDTSC 1
+#elif defined(_M_X64)
+#    include <intrin.h>
+#    define SUPDXFD_HAVE_RDTSC 1
+#endif
+
+// The time stamp counter where there is one, steady clock nanoseconds otherwise. Never zero.
+inline std::uint64_t traceTicks() {
+#ifdef SUPDXFD_HAVE_RDTSC
+    return __rdtsc() | 1;
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count()) |
+           1;
+#endif
+}
+
+// Per-stage latency distributions of sampled batches. One batch in `every` is stamped with traceTicks() at intake and
+// again at each stage boundary; the difference between two stamps is recorded in the histogram of that segment. The
+// histograms have power-of-two buckets and are updated with relaxed atomics, so unsampled batches cost one counter
+// increment and sampled ones a few more. Ticks are converted to nanoseconds by the rate measured since construction.
+class StageTracer {
+    struct Histogram {
+        std::string name{};
+        std::array<std::atomic<std::uint64_t>, 64> buckets{};
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> totalTicks{0};
+        std::atomic<std::uint64_t> maxTicks{0};
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    std::uint64_t every;
+    std::atomic<std::uint64_t> seen{0};
+    std::mutex mutex{};
+    std::vector<std::unique_ptr<Histogram>> histograms{};
+    Clock::time_point startTime{Clock::now()};
+    std::uint64_t startTicks{traceTicks()};
+
+    static std::size_t bucketOf(std::uint64_t ticks) {
+        std::size_t b = 0;
+
+        while (ticks > 1 && b < 63) {
+            ticks >>= 1;
+            b++;
+        }
+
+        return b;
+    }
+
+    double nanosPerTick() const {
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count();
+        auto ticks = traceTicks() - startTicks;
+
+        return ticks == 0 || nanos <= 0 ? 1.0 : static_cast<double>(nanos) / static_cast<double>(ticks);
+    }
+
+    // The upper bound of the bucket holding the given fraction of the samples, in ticks.
+    static std::uint64_t percentile(const Histogram &h, std::uint64_t count, double fraction) {
+        auto rank = static_cast<std::uint64_t>(static_cast<double>(count) * fraction);
+        std::uint64_t cumulative = 0;
+
+        for (std::size_t b = 0; b < h.buckets.size(); b++) {
+            cumulative += h.buckets[b].load(std::memory_order_relaxed);
+
+            if (cumulative > rank) {
+                return std::uint64_t{2} << b;
+            }
+        }
+
+        return h.maxTicks.load(std::memory_order_relaxed);
+    }
+
+  public:
+    explicit StageTracer(std::uint64_t every) : every(every == 0 ? 1 : every) {
+    }
+
+    // Returns the intake stamp for a sampled batch, zero for the others.
+    std::uint64_t sample() {
+        return seen.fetch_add(1, std::memory_order_relaxed) % every == 0 ? traceTicks() : 0;
+    }
+
+    // Returns the id of the named segment, registering it on first use. Segments are registered before the stamps
+    // start flowing; later calls only look them up.
+    std::size_t segment(const std::string &name) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        for (std::size_t i = 0; i < histograms.size(); i++) {
+            if (histograms[i]->name == name) {
+                return i;
+            }
+        }
+
+        histograms.emplace_back(new Histogram{});
+        histograms.back()->name = name;
+
+        return histograms.size() - 1;
+    }
+
+    // Records the time from `from` to `to`; a zero `from` is an unsampled batch.
+    void record(std::size_t segment, std::uint64_t from, std::uint64_t to) {
+        if (from == 0 || to < from) {
+            return;
+        }
+
+        auto &h = *histograms[segment];
+        auto ticks = to - from;
+
+        h.buckets[bucketOf(ticks)].fetch_add(1, std::memory_order_relaxed);
+        h.count.fetch_add(1, std::memory_order_relaxed);
+        h.totalTicks.fetch_add(ticks, std::memory_order_relaxed);
+
+        auto max = h.maxTicks.load(std::memory_order_relaxed);
+
+        while (ticks > max && !h.maxTicks.compare_exchange_weak(max, ticks, std::memory_order_relaxed)) {
+        }
+    }
+
+    // One line per segment: "Trace queue top-of-book: 1200 samples, avg 3.1 us, p50 < 2.0 us, p99 < 16.4 us, ..."
+    std::string toText() {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto scale = nanosPerTick() / 1000.0;
+        std::string text{};
+
+        for (auto &h : histograms) {
+            auto n = h->count.load(std::memory_order_relaxed);
+
+            if (n == 0) {
+                continue;
+            }
+
+            text += fmt::format("Trace {}: {} samples, avg {:.1f} us, p50 < {:.1f} us, p99 < {:.1f} us, "
+                                "max {:.1f} us\n",
+                                h->name, n, h->totalTicks.load(std::memory_order_relaxed) * scale / n,
+                                percentile(*h, n, 0.5) * scale, percentile(*h, n, 0.99) * scale,
+                                h->maxTicks.load(std::memory_order_relaxed) * scale);
+        }
+
+        return text.empty() ? "Trace: no samples\n" : text;
+    }
+};
@@ -0,0 +1,120 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "SymbolTable.hpp"
+#include "TimerWheel.hpp"
+#include "TopOfBook.hpp"
+
+// Detects symbols that received no quote within `timeout`. Every quote re-arms the symbol's timer in a timing wheel
+// (O(1)); a ticker thread advances the wheel, marks expired symbols stale in the top-of-book table and raises an
+// alert. The next quote of a stale symbol raises a recovery alert. Nothing scans the whole universe.
+class StaleQuoteMonitor {
+  public:
+    // Called without the monitor lock held.
+    using Alert = std::function<void(std::uint32_t symbolId, bool stale)>;
+
+  private:
+    TopOfBook &book;
+    SymbolTable &symbols;
+    std::chrono::milliseconds tick;
+    std::int64_t timeoutTicks;
+    Alert alert;
+    std::chrono::steady_clock::time_point origin{std::chrono::steady_clock::now()};
+    std::mutex mutex{};
+    TimerWheel wheel{};
+    std::vector<std::uint8_t> staleFlags{};
+    std::atomic<bool> running{false};
+    std::thread thread{};
+
+    std::int64_t ticksNow() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - origin).count() /
+               tick.count();
+    }
+
+    void run() {
+        std::vector<std::uint32_t> expired{};
+
+        while (running) {
+            std::this_thread::sleep_for(tick);
+            expired.clear();
+
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+
+                wheel.advance(ticksNow(), [this, &expired](std::uint32_t id) {
+                    staleFlags[id] = 1;
+                    book.markStale(id);
+                    expired.push_back(id);
+                });
+            }
+
+            for (auto id : expired) {
+                alert(id, true);
+            }
+        }
+    }
+
+  public:
+    StaleQuoteMonitor(TopOfBook &book, std::chrono::milliseconds timeout, Alert alert,
+                      std::chrono::milliseconds tick = std::chrono::milliseconds(10))
+        : book(book), symbols(book.symbolTable()), tick(tick), timeoutTicks(std::max<std::int64_t>(timeout / tick, 1)),
+          alert(std::move(alert)) {
+    }
+
+    // Must be called before the quote is applied to the top-of-book table, so an expiry racing with the quote cannot
+    // leave the entry marked stale.
+    void onQuote(dxf_const_string_t symbolName) {
+        onQuote(symbols.intern(symbolName).first);
+    }
+
+    // `id` is an id of the book's symbol table.
+    void onQuote(std::uint32_t id) {
+        bool recovered = false;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            if (id >= staleFlags.size()) {
+                staleFlags.resize(id + 1, 0);
+            }
+
+            wheel.schedule(id, ticksNow() + timeoutTicks);
+            recovered = staleFlags[id] != 0;
+            staleFlags[id] = 0;
+        }
+
+        if (recovered) {
+            alert(id, false);
+        }
+    }
+
+    void start() {
+        running = true;
+        thread = std::thread(&StaleQuoteMonitor::run, this);
+    }
+
+    void stop() {
+        running = false;
+
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    ~StaleQuoteMonitor() {
+        stop();
+    }
+};
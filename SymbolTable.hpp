@@ -0,0 +1,84 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Interns symbol names into dense 32-bit ids. Ids are never reused, so they can index flat per-symbol arrays.
+class SymbolTable {
+    mutable std::mutex mutex{};
+    std::unordered_map<std::wstring, std::uint32_t> ids{};
+    std::vector<std::wstring> names{};
+
+  public:
+    static constexpr std::uint32_t INVALID_ID = 0xFFFFFFFFu;
+
+    // Returns the id of the symbol and whether it was seen for the first time.
+    std::pair<std::uint32_t, bool> intern(const std::wstring &symbol) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto found = ids.find(symbol);
+
+        if (found != ids.end()) {
+            return {found->second, false};
+        }
+
+        auto id = static_cast<std::uint32_t>(names.size());
+
+        ids.emplace(symbol, id);
+        names.push_back(symbol);
+
+        return {id, true};
+    }
+
+    // Interns a batch under one lock; ids[i] is the id of symbols[i].
+    void internAll(const std::vector<std::wstring> &symbols, std::vector<std::uint32_t> &out) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        out.clear();
+        out.reserve(symbols.size());
+        ids.reserve(ids.size() + symbols.size());
+
+        for (auto &symbol : symbols) {
+            auto inserted = ids.emplace(symbol, static_cast<std::uint32_t>(names.size()));
+
+            if (inserted.second) {
+                names.push_back(symbol);
+            }
+
+            out.push_back(inserted.first->second);
+        }
+    }
+
+    std::uint32_t find(const std::wstring &symbol) const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto found = ids.find(symbol);
+
+        return found == ids.end() ? INVALID_ID : found->second;
+    }
+
+    std::wstring name(std::uint32_t id) const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        return id < names.size() ? names[id] : std::wstring{};
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        return names.size();
+    }
+};
+
+inline SymbolTable &globalSymbols() {
+    static SymbolTable table{};
+
+    return table;
+}
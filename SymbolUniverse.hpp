@@ -0,0 +1,135 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "SymbolTable.hpp"
+
+struct SymbolDiff {
+    std::vector<std::uint32_t> added{};
+    std::vector<std::uint32_t> removed{};
+};
+
+// Minimal add/remove sets turning `live` into `desired`, both sorted and unique, by one merge pass.
+inline void diffSymbolSets(const std::vector<std::uint32_t> &live, const std::vector<std::uint32_t> &desired,
+                           SymbolDiff &out) {
+    std::size_t i = 0;
+    std::size_t j = 0;
+
+    out.added.clear();
+    out.removed.clear();
+
+    while (i < live.size() || j < desired.size()) {
+        if (j == desired.size() || (i < live.size() && live[i] < desired[j])) {
+            out.removed.push_back(live[i++]);
+        } else if (i == live.size() || desired[j] < live[i]) {
+            out.added.push_back(desired[j++]);
+        } else {
+            i++;
+            j++;
+        }
+    }
+}
+
+inline std::future<bool> readyFuture(bool value) {
+    std::promise<bool> promise{};
+
+    promise.set_value(value);
+
+    return promise.get_future();
+}
+
+// The symbol set of a live subscription, kept as sorted interned ids. reconcile() moves it to a new desired set by
+// applying only the difference, in batches, so unchanged symbols are never touched.
+class SymbolUniverse {
+  public:
+    // Applies, or queues, one batch of additions or removals to the subscription; the future is false if the call
+    // failed.
+    using Apply = std::function<std::future<bool>(const std::vector<std::wstring> &batch)>;
+
+  private:
+    SymbolTable &symbols;
+    std::size_t batchSize;
+    std::vector<std::uint32_t> live{};
+
+    // Applies `ids` in batches; returns the ids of the batches that succeeded. All batches are handed to `apply` before
+    // any result is awaited, so a paced subscription can merge those still queued.
+    std::vector<std::uint32_t> applyInBatches(const std::vector<std::uint32_t> &ids, const Apply &apply) {
+        std::vector<std::uint32_t> applied{};
+        std::vector<std::future<bool>> results{};
+        std::vector<std::wstring> batch{};
+
+        for (std::size_t from = 0; from < ids.size(); from += batchSize) {
+            auto to = std::min(ids.size(), from + batchSize);
+
+            batch.clear();
+
+            for (auto k = from; k < to; k++) {
+                batch.push_back(symbols.name(ids[k]));
+            }
+
+            results.push_back(apply(batch));
+        }
+
+        for (std::size_t i = 0; i < results.size(); i++) {
+            if (results[i].get()) {
+                auto from = i * batchSize;
+                auto to = std::min(ids.size(), from + batchSize);
+
+                applied.insert(applied.end(), ids.begin() + static_cast<std::ptrdiff_t>(from),
+                               ids.begin() + static_cast<std::ptrdiff_t>(to));
+            }
+        }
+
+        return applied;
+    }
+
+  public:
+    explicit SymbolUniverse(SymbolTable &symbols, std::size_t batchSize = 512)
+        : symbols(symbols), batchSize(std::max<std::size_t>(batchSize, 1)) {
+    }
+
+    std::size_t size() const {
+        return live.size();
+    }
+
+    // Removals are applied before additions. Returns the difference that was actually applied.
+    SymbolDiff reconcile(const std::vector<std::wstring> &desiredNames, const Apply &add, const Apply &remove) {
+        std::vector<std::uint32_t> desired{};
+
+        desired.reserve(desiredNames.size());
+
+        for (auto &name : desiredNames) {
+            desired.push_back(symbols.intern(name).first);
+        }
+
+        std::sort(desired.begin(), desired.end());
+        desired.erase(std::unique(desired.begin(), desired.end()), desired.end());
+
+        SymbolDiff diff{};
+
+        diffSymbolSets(live, desired, diff);
+
+        SymbolDiff applied{};
+        std::vector<std::uint32_t> next{};
+
+        applied.removed = applyInBatches(diff.removed, remove);
+        applied.added = applyInBatches(diff.added, add);
+
+        // live - removed + added; all three are sorted.
+        std::set_difference(live.begin(), live.end(), applied.removed.begin(), applied.removed.end(),
+                            std::back_inserter(next));
+        live.clear();
+        std::merge(next.begin(), next.end(), applied.added.begin(), applied.added.end(), std::back_inserter(live));
+
+        return applied;
+    }
+};
@@ -0,0 +1,49 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "BinaryWriter.hpp"
+#include "FileSink.hpp"
+
+// Records events to a file in the binary stream format (see BinaryProtocol.hpp), so a tape can be replayed with the
+// same reader that consumes `--binary` output.
+class TapeRecorder {
+    std::mutex mutex{};
+    std::unique_ptr<FileSink> sink;
+    BinaryEncoder encoder;
+    std::vector<char> buffer{};
+
+  public:
+    TapeRecorder(std::unique_ptr<FileSink> sink, SymbolTable &symbols) : sink(std::move(sink)), encoder(symbols) {
+    }
+
+    // The symbol is given by name or by its id in the recorder's symbol table.
+    template<typename Symbol>
+    void recordQuotes(Symbol symbol, const dxf_quote_t *quotes, int count) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        encoder.encodeQuotes(symbol, quotes, count, buffer);
+        sink->write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    template<typename Symbol>
+    void recordTrades(Symbol symbol, const dxf_trade_t *trades, int count, const std::uint8_t *aggressorSides) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        encoder.encodeTrades(symbol, trades, count, aggressorSides, buffer);
+        sink->write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    void flush() {
+        sink->flush();
+    }
+};
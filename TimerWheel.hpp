@@ -0,0 +1,163 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel of one timer per id (e.g. per symbol id): 4 levels of 64 slots, each level 64 times
+// coarser than the one below, so deadlines up to 2^24 ticks ahead are held without a heap. Timers are intrusive
+// doubly linked list nodes indexed by id, so (re)scheduling and cancelling are O(1). A timer in an upper level is
+// cascaded down when the wheel reaches its slot; expiry happens in level 0 at tick resolution.
+//
+// Not thread-safe: the owner serializes schedule/cancel/advance.
+class TimerWheel {
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr std::uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr std::uint32_t NONE = 0xFFFFFFFFu;
+
+    struct Node {
+        std::uint32_t prev{NONE};
+        std::uint32_t next{NONE};
+        std::uint32_t slot{NONE};// index in heads, NONE if not scheduled
+        std::int64_t deadline{0};
+    };
+
+    std::int64_t now;
+    std::vector<Node> nodes{};
+    std::vector<std::uint32_t> heads = std::vector<std::uint32_t>(LEVELS * SLOTS, std::uint32_t{NONE});
+
+    void link(std::uint32_t id, std::uint32_t slot) {
+        auto &n = nodes[id];
+
+        n.slot = slot;
+        n.prev = NONE;
+        n.next = heads[slot];
+
+        if (n.next != NONE) {
+            nodes[n.next].prev = id;
+        }
+
+        heads[slot] = id;
+    }
+
+    void unlink(std::uint32_t id) {
+        auto &n = nodes[id];
+
+        if (n.slot == NONE) {
+            return;
+        }
+
+        if (n.prev != NONE) {
+            nodes[n.prev].next = n.next;
+        } else {
+            heads[n.slot] = n.next;
+        }
+
+        if (n.next != NONE) {
+            nodes[n.next].prev = n.prev;
+        }
+
+        n.slot = NONE;
+    }
+
+    // The lowest level whose slot for the deadline is less than a full turn ahead of the current slot.
+    void place(std::uint32_t id) {
+        auto deadline = nodes[id].deadline;
+
+        for (int level = 0; level < LEVELS; level++) {
+            auto shift = level * SLOT_BITS;
+
+            if ((deadline >> shift) - (now >> shift) < static_cast<std::int64_t>(SLOTS)) {
+                link(id, level * SLOTS + static_cast<std::uint32_t>((deadline >> shift) & (SLOTS - 1)));
+
+                return;
+            }
+        }
+
+        // Beyond the top level: park in the last slot of the top level; it is re-placed when cascaded.
+        auto shift = (LEVELS - 1) * SLOT_BITS;
+
+        link(id, (LEVELS - 1) * SLOTS + static_cast<std::uint32_t>(((now >> shift) + SLOTS - 1) & (SLOTS - 1)));
+    }
+
+    std::uint32_t detach(std::uint32_t slot) {
+        auto head = heads[slot];
+
+        heads[slot] = NONE;
+
+        for (auto id = head; id != NONE; id = nodes[id].next) {
+            nodes[id].slot = NONE;
+        }
+
+        return head;
+    }
+
+  public:
+    explicit TimerWheel(std::int64_t startTick = 0) : now(startTick) {
+    }
+
+    std::int64_t currentTick() const {
+        return now;
+    }
+
+    // Arms (or re-arms) timer `id` to expire at `deadline`; a deadline not in the future expires on the next tick.
+    void schedule(std::uint32_t id, std::int64_t deadline) {
+        if (id >= nodes.size()) {
+            nodes.resize(id + 1);
+        }
+
+        unlink(id);
+        nodes[id].deadline = deadline > now ? deadline : now + 1;
+        place(id);
+    }
+
+    void cancel(std::uint32_t id) {
+        if (id < nodes.size()) {
+            unlink(id);
+        }
+    }
+
+    bool scheduled(std::uint32_t id) const {
+        return id < nodes.size() && nodes[id].slot != NONE;
+    }
+
+    // Moves the wheel to `tick`, calling onExpire(id) for every timer whose deadline has passed. onExpire may re-arm
+    // the expired id but no other timer.
+    template<typename OnExpire>
+    void advance(std::int64_t tick, OnExpire onExpire) {
+        while (now < tick) {
+            now++;
+
+            // When a level wraps, the next slot of the level above is due: redistribute it downwards.
+            for (int level = 1; level < LEVELS; level++) {
+                if (((now >> ((level - 1) * SLOT_BITS)) & (SLOTS - 1)) != 0) {
+                    break;
+                }
+
+                auto slot = level * SLOTS + static_cast<std::uint32_t>((now >> (level * SLOT_BITS)) & (SLOTS - 1));
+
+                for (auto id = detach(slot); id != NONE;) {
+                    auto next = nodes[id].next;
+
+                    place(id);
+                    id = next;
+                }
+            }
+
+            for (auto id = detach(static_cast<std::uint32_t>(now & (SLOTS - 1))); id != NONE;) {
+                auto next = nodes[id].next;
+
+                if (nodes[id].deadline <= now) {
+                    onExpire(id);
+                } else {
+                    place(id);
+                }
+
+                id = next;
+            }
+        }
+    }
+};
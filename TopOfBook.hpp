@@ -0,0 +1,94 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "SymbolTable.hpp"
+
+// Latest quote and running statistics of a symbol.
+struct TopOfBookEntry {
+    bool valid{false};
+    double bidPrice{0.0};
+    double bidSize{0.0};
+    double askPrice{0.0};
+    double askSize{0.0};
+    dxf_order_scope_t scope{dxf_osc_composite};
+    std::int64_t eventTime{0};  // ms since epoch, from the quote
+    std::int64_t receiveTime{0};// ms since epoch, when the listener saw it
+    std::uint64_t updates{0};
+    double latencyMillis{0.0};// exponentially smoothed receiveTime - eventTime
+    bool stale{false};        // no quote within the staleness timeout, cleared by the next quote
+};
+
+// Latest quote per symbol id. Updated by the listeners, read in bulk by the dashboard and other monitors.
+class TopOfBook {
+    mutable std::mutex mutex{};
+    SymbolTable &symbols;
+    std::vector<TopOfBookEntry> entries{};
+
+  public:
+    explicit TopOfBook(SymbolTable &symbols) : symbols(symbols) {
+    }
+
+    SymbolTable &symbolTable() const {
+        return symbols;
+    }
+
+    void update(dxf_const_string_t symbolName, const dxf_quote_t *quotes, int count) {
+        update(symbols.intern(symbolName).first, quotes, count);
+    }
+
+    // `symbolId` is an id of symbolTable().
+    void update(std::uint32_t symbolId, const dxf_quote_t *quotes, int count) {
+        if (count <= 0) {
+            return;
+        }
+
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId >= entries.size()) {
+            entries.resize(symbolId + 1);
+        }
+
+        auto &e = entries[symbolId];
+        auto &q = quotes[count - 1];
+        auto latency = static_cast<double>(now - q.time);
+
+        e.latencyMillis = e.valid ? e.latencyMillis + (latency - e.latencyMillis) / 16.0 : latency;
+        e.valid = true;
+        e.bidPrice = q.bid_price;
+        e.bidSize = q.bid_size;
+        e.askPrice = q.ask_price;
+        e.askSize = q.ask_size;
+        e.scope = q.scope;
+        e.eventTime = q.time;
+        e.receiveTime = now;
+        e.updates += static_cast<std::uint64_t>(count);
+        e.stale = false;
+    }
+
+    void markStale(std::uint32_t symbolId) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId < entries.size()) {
+            entries[symbolId].stale = true;
+        }
+    }
+
+    // Copies all entries, indexed by symbol id.
+    void snapshot(std::vector<TopOfBookEntry> &out) const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        out = entries;
+    }
+};
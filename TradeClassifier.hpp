@@ -0,0 +1,107 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <DXFeed.h>
+
+#include "BinaryProtocol.hpp"
+#include "QuoteHistory.hpp"
+
+enum class TradeRule { NONE,
+                       QUOTE,
+                       TICK };
+
+struct TradeClassification {
+    binproto::AggressorSide side{binproto::SIDE_UNKNOWN};
+    TradeRule rule{TradeRule::NONE};
+    bool hasQuote{false};
+    QuoteSample quote{};// the prevailing quote, valid if hasQuote
+};
+
+inline const char *aggressorSideToString(binproto::AggressorSide side) {
+    switch (side) {
+        case binproto::SIDE_BUY:
+            return "Buy";
+        case binproto::SIDE_SELL:
+            return "Sell";
+        case binproto::SIDE_UNKNOWN:
+            break;
+    }
+
+    return "Unknown";
+}
+
+// As-of join of trades against the quote history: each trade is paired with the prevailing quote of its symbol at
+// trade time and classified as buyer or seller initiated (Lee-Ready). Regional trades and quotes use their own
+// symbols (e.g. "AAPL&Q"), so the join is per venue when the subscriptions are.
+//
+// Quote rule: a trade above the mid is a buy, below the mid a sell. At the mid, or without a usable quote, the tick
+// rule applies: an uptick is a buy, a downtick a sell, a zero tick takes the direction of the last price change.
+class TradeClassifier {
+    struct TickState {
+        double lastPrice{0.0};
+        binproto::AggressorSide lastTickSide{binproto::SIDE_UNKNOWN};
+        bool hasLast{false};
+    };
+
+    QuoteHistory &history;
+    std::mutex mutex{};
+    std::vector<TickState> ticks{};
+
+    // Applies the trade price to the tick state and returns the tick rule side.
+    static binproto::AggressorSide tick(TickState &state, double price) {
+        if (state.hasLast && price != state.lastPrice) {
+            state.lastTickSide = price > state.lastPrice ? binproto::SIDE_BUY : binproto::SIDE_SELL;
+        }
+
+        state.lastPrice = price;
+        state.hasLast = true;
+
+        return state.lastTickSide;
+    }
+
+  public:
+    explicit TradeClassifier(QuoteHistory &history) : history(history) {
+    }
+
+    TradeClassification classify(std::uint32_t symbolId, const dxf_trade_t &trade) {
+        TradeClassification result{};
+
+        result.hasQuote = history.asOf(symbolId, trade.time, result.quote);
+
+        auto &q = result.quote;
+        bool usableQuote = result.hasQuote && q.bidPrice > 0.0 && q.askPrice >= q.bidPrice;
+
+        if (usableQuote) {
+            auto mid = (q.bidPrice + q.askPrice) / 2.0;
+
+            if (trade.price > mid) {
+                result.side = binproto::SIDE_BUY;
+                result.rule = TradeRule::QUOTE;
+            } else if (trade.price < mid) {
+                result.side = binproto::SIDE_SELL;
+                result.rule = TradeRule::QUOTE;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        if (symbolId >= ticks.size()) {
+            ticks.resize(symbolId + 1);
+        }
+
+        auto tickSide = tick(ticks[symbolId], trade.price);
+
+        if (result.rule == TradeRule::NONE && tickSide != binproto::SIDE_UNKNOWN) {
+            result.side = tickSide;
+            result.rule = TradeRule::TICK;
+        }
+
+        return result;
+    }
+};
@@ -0,0 +1,407 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include "FileSink.hpp"
+
+#if defined(__linux__) && defined(__has_include)
+#    if __has_include(<linux/io_uring.h>)
+#        define SUPDXFD_HAVE_IO_URING 1
+#    endif
+#endif
+
+#ifdef SUPDXFD_HAVE_IO_URING
+
+#    include <algorithm>
+#    include <cerrno>
+#    include <chrono>
+#    include <cstdint>
+#    include <cstring>
+#    include <vector>
+
+#    include <fcntl.h>
+#    include <linux/io_uring.h>
+#    include <sys/mman.h>
+#    include <sys/syscall.h>
+#    include <sys/uio.h>
+#    include <unistd.h>
+
+// File sink that writes through io_uring. Data is copied into one of several registered buffers; full buffers are
+// queued as WRITE_FIXED requests and submitted in batches, so the producing thread only blocks when every buffer is
+// in flight. Uses the raw syscalls, no liburing dependency.
+class UringFileSink : public FileSink {
+    struct Buffer {
+        std::size_t used{0};       // bytes filled by the producer
+        std::size_t written{0};    // bytes confirmed by completions
+        std::uint64_t offset{0};   // file offset of the first byte
+        bool inFlight{false};
+    };
+
+    std::mutex mutex{};
+    int fd{-1};
+    int ringFd{-1};
+    bool fixedBuffers{false};
+    bool failed{false};
+
+    void *sqRing{nullptr};
+    void *cqRing{nullptr};
+    std::size_t sqRingSize{0};
+    std::size_t cqRingSize{0};
+    io_uring_sqe *sqes{nullptr};
+    std::size_t sqesSize{0};
+    unsigned *sqTail{nullptr};
+    unsigned sqMask{0};
+    unsigned *sqArray{nullptr};
+    unsigned *cqHead{nullptr};
+    unsigned *cqTail{nullptr};
+    unsigned cqMask{0};
+    io_uring_cqe *cqes{nullptr};
+
+    std::size_t bufferSize;
+    std::vector<char> storage{};
+    std::vector<Buffer> buffers{};
+    std::vector<int> freeBuffers{};
+    int current{-1};
+    std::chrono::steady_clock::time_point currentStarted{};
+    std::chrono::milliseconds maxDelay{100};
+    std::uint64_t fileOffset{0};
+    unsigned unsubmitted{0};
+    unsigned inFlight{0};
+    unsigned submitBatch;
+
+    static int enter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    char *data(int index) {
+        return storage.data() + static_cast<std::size_t>(index) * bufferSize;
+    }
+
+    void reportError(int error) {
+        if (!failed) {
+            failed = true;
+            std::fprintf(stderr, "UringFileSink: write failed: %s\n", std::strerror(error));
+        }
+    }
+
+    void queueWrite(int index) {
+        auto &b = buffers[static_cast<std::size_t>(index)];
+        unsigned tail = *sqTail;
+        unsigned slot = tail & sqMask;
+        auto *sqe = &sqes[slot];
+
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = fixedBuffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(data(index) + b.written);
+        sqe->len = static_cast<std::uint32_t>(b.used - b.written);
+        sqe->off = b.offset + b.written;
+        sqe->buf_index = static_cast<std::uint16_t>(fixedBuffers ? index : 0);
+        sqe->user_data = static_cast<std::uint64_t>(index);
+        sqArray[slot] = slot;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        if (!b.inFlight) {
+            b.inFlight = true;
+            inFlight++;
+        }
+
+        unsubmitted++;
+    }
+
+    void queueCurrent() {
+        if (current < 0) {
+            return;
+        }
+
+        auto &b = buffers[static_cast<std::size_t>(current)];
+
+        if (b.used == 0) {
+            return;
+        }
+
+        SUPDXFD_PROBE2(sink__flush, "io_uring", b.used);
+        b.offset = fileOffset;
+        b.written = 0;
+        fileOffset += b.used;
+        queueWrite(current);
+        current = -1;
+    }
+
+    // Consumes available completions. Short writes are requeued for the remainder; returns true if any was, and the
+    // caller submits them. A write that made no progress fails the rest of its buffer rather than being retried.
+    bool reap() {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        bool requeued = false;
+
+        for (; head != tail; head++) {
+            auto &cqe = cqes[head & cqMask];
+            auto index = static_cast<int>(cqe.user_data);
+            auto &b = buffers[static_cast<std::size_t>(index)];
+
+            if (cqe.res < 0 || (cqe.res == 0 && b.written < b.used)) {
+                reportError(cqe.res < 0 ? -cqe.res : EIO);
+                b.written = b.used;
+            } else {
+                b.written += static_cast<std::size_t>(cqe.res);
+            }
+
+            if (b.written < b.used) {
+                queueWrite(index);
+                requeued = true;
+
+                continue;
+            }
+
+            b.inFlight = false;
+            b.used = 0;
+            inFlight--;
+            freeBuffers.push_back(index);
+        }
+
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+        return requeued;
+    }
+
+    // Submits the queued writes, and then the remainders requeued by the completions it reaps. Returns false if the
+    // ring itself failed; the caller must not wait for completions then.
+    bool submit(unsigned minComplete) {
+        do {
+            while (unsubmitted != 0 || minComplete != 0) {
+                int result = enter(ringFd, unsubmitted, minComplete, minComplete != 0 ? IORING_ENTER_GETEVENTS : 0);
+
+                if (result < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    if (errno == EAGAIN || errno == EBUSY) {
+                        reap();
+
+                        continue;
+                    }
+
+                    reportError(errno);
+
+                    return false;
+                }
+
+                unsubmitted -= static_cast<unsigned>(result);
+                minComplete = 0;
+            }
+        } while (reap());
+
+        return true;
+    }
+
+    int acquireBuffer() {
+        while (freeBuffers.empty()) {
+            if (!submit(1)) {
+                // The ring is unusable: drop everything buffered rather than blocking forever.
+                for (std::size_t i = 0; i < buffers.size(); i++) {
+                    buffers[i] = Buffer{};
+                    freeBuffers.push_back(static_cast<int>(i));
+                }
+
+                inFlight = 0;
+            }
+        }
+
+        auto index = freeBuffers.back();
+
+        freeBuffers.pop_back();
+        currentStarted = std::chrono::steady_clock::now();
+
+        return index;
+    }
+
+    bool setup(const std::string &path, unsigned bufferCount) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if (fd < 0) {
+            return false;
+        }
+
+        io_uring_params params{};
+
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, bufferCount, &params));
+
+        if (ringFd < 0) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+        if (singleMmap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                      IORING_OFF_SQ_RING);
+
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+
+            return false;
+        }
+
+        cqRing = singleMmap ? sqRing
+                            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                                   IORING_OFF_CQ_RING);
+
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+
+            return false;
+        }
+
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+        auto *sqesMemory = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                                IORING_OFF_SQES);
+
+        if (sqesMemory == MAP_FAILED) {
+            return false;
+        }
+
+        sqes = static_cast<io_uring_sqe *>(sqesMemory);
+
+        auto *sq = static_cast<char *>(sqRing);
+        auto *cq = static_cast<char *>(cqRing);
+
+        sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        storage.resize(bufferSize * bufferCount);
+        buffers.resize(bufferCount);
+
+        std::vector<iovec> iovecs(bufferCount);
+
+        for (unsigned i = 0; i < bufferCount; i++) {
+            iovecs[i].iov_base = data(static_cast<int>(i));
+            iovecs[i].iov_len = bufferSize;
+            freeBuffers.push_back(static_cast<int>(bufferCount - 1 - i));
+        }
+
+        // Registration pins the pages and can fail under a low RLIMIT_MEMLOCK; plain writes still work then.
+        fixedBuffers = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, iovecs.data(), bufferCount) == 0;
+
+        return true;
+    }
+
+    UringFileSink(std::size_t bufferSize, unsigned bufferCount)
+        : bufferSize(bufferSize), submitBatch(std::max(1u, bufferCount / 2)) {
+    }
+
+  public:
+    // Returns nullptr if the file cannot be opened or io_uring is not available (old kernel, seccomp, etc.).
+    static std::unique_ptr<FileSink> open(const std::string &path, std::size_t bufferSize = 1 << 20,
+                                          unsigned bufferCount = 8) {
+        std::unique_ptr<UringFileSink> sink{new UringFileSink(bufferSize, bufferCount)};
+
+        if (!sink->setup(path, bufferCount)) {
+            return nullptr;
+        }
+
+        return sink;
+    }
+
+    void write(const char *bytes, std::size_t size) override {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        while (size != 0) {
+            if (current < 0) {
+                current = acquireBuffer();
+            }
+
+            auto &b = buffers[static_cast<std::size_t>(current)];
+            auto chunk = std::min(size, bufferSize - b.used);
+
+            std::memcpy(data(current) + b.used, bytes, chunk);
+            b.used += chunk;
+            bytes += chunk;
+            size -= chunk;
+
+            if (b.used == bufferSize) {
+                queueCurrent();
+            }
+        }
+
+        // Slow producers (text logs) should not keep data in memory indefinitely.
+        if (current >= 0 && std::chrono::steady_clock::now() - currentStarted >= maxDelay) {
+            queueCurrent();
+        }
+
+        if (unsubmitted >= submitBatch || (unsubmitted != 0 && freeBuffers.empty()) || (inFlight != 0 && reap())) {
+            submit(0);
+        }
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        queueCurrent();
+        submit(0);
+    }
+
+    ~UringFileSink() override {
+        if (ringFd >= 0 && sqes) {
+            queueCurrent();
+
+            while (inFlight != 0 && submit(1)) {
+            }
+        }
+
+        if (sqes) {
+            munmap(sqes, sqesSize);
+        }
+
+        if (cqRing && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+
+        if (sqRing) {
+            munmap(sqRing, sqRingSize);
+        }
+
+        if (ringFd >= 0) {
+            close(ringFd);
+        }
+
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+#endif// SUPDXFD_HAVE_IO_URING
+
+// Opens an io_uring sink when requested and supported, otherwise a stdio one.
+inline std::unique_ptr<FileSink> openFileSink(const std::string &path, bool preferUring) {
+#ifdef SUPDXFD_HAVE_IO_URING
+    if (preferUring) {
+        auto sink = UringFileSink::open(path);
+
+        if (sink) {
+            return sink;
+        }
+
+        std::fprintf(stderr, "io_uring is not available for %s, falling back to buffered writes\n", path.c_str());
+    }
+#else
+    (void) preferUring;
+#endif
+
+    return StdioFileSink::open(path, 1 << 20);
+}
@@ -0,0 +1,380 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#endif
+
+// A minimal packed-double type for branch-free numeric kernels: 4 lanes with AVX2, 2 with SSE2, 1 otherwise.
+// Kernels are written once against Vec/Mask; conditionals become masks and select().
+namespace vmath {
+
+#if defined(__AVX2__)
+
+struct Vec {
+    __m256d v;
+
+    static constexpr std::size_t WIDTH = 4;
+};
+
+struct Mask {
+    __m256d v;
+};
+
+inline Vec set1(double x) {
+    return {_mm256_set1_pd(x)};
+}
+
+inline Vec load(const double *p) {
+    return {_mm256_loadu_pd(p)};
+}
+
+inline void store(double *p, Vec x) {
+    _mm256_storeu_pd(p, x.v);
+}
+
+inline Vec operator+(Vec a, Vec b) {
+    return {_mm256_add_pd(a.v, b.v)};
+}
+
+inline Vec operator-(Vec a, Vec b) {
+    return {_mm256_sub_pd(a.v, b.v)};
+}
+
+inline Vec operator*(Vec a, Vec b) {
+    return {_mm256_mul_pd(a.v, b.v)};
+}
+
+inline Vec operator/(Vec a, Vec b) {
+    return {_mm256_div_pd(a.v, b.v)};
+}
+
+inline Vec min(Vec a, Vec b) {
+    return {_mm256_min_pd(a.v, b.v)};
+}
+
+inline Vec max(Vec a, Vec b) {
+    return {_mm256_max_pd(a.v, b.v)};
+}
+
+inline Vec sqrt(Vec a) {
+    return {_mm256_sqrt_pd(a.v)};
+}
+
+inline Vec abs(Vec a) {
+    return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)};
+}
+
+inline Vec round(Vec a) {
+    return {_mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+}
+
+// 2^n for integral n in [-1022, 1023].
+inline Vec pow2(Vec n) {
+    auto e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n.v));
+
+    e = _mm256_slli_epi64(_mm256_add_epi64(e, _mm256_set1_epi64x(1023)), 52);
+
+    return {_mm256_castsi256_pd(e)};
+}
+
+inline Mask operator<(Vec a, Vec b) {
+    return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)};
+}
+
+inline Mask operator>(Vec a, Vec b) {
+    return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)};
+}
+
+inline Mask operator&(Mask a, Mask b) {
+    return {_mm256_and_pd(a.v, b.v)};
+}
+
+inline Mask operator|(Mask a, Mask b) {
+    return {_mm256_or_pd(a.v, b.v)};
+}
+
+inline Mask operator!(Mask a) {
+    return {_mm256_xor_pd(a.v, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)))};
+}
+
+// a where mask is set, b elsewhere.
+inline Vec select(Mask mask, Vec a, Vec b) {
+    return {_mm256_blendv_pd(b.v, a.v, mask.v)};
+}
+
+inline bool all(Mask mask) {
+    return _mm256_movemask_pd(mask.v) == 0xF;
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct Vec {
+    __m128d v;
+
+    static constexpr std::size_t WIDTH = 2;
+};
+
+struct Mask {
+    __m128d v;
+};
+
+inline Vec set1(double x) {
+    return {_mm_set1_pd(x)};
+}
+
+inline Vec load(const double *p) {
+    return {_mm_loadu_pd(p)};
+}
+
+inline void store(double *p, Vec x) {
+    _mm_storeu_pd(p, x.v);
+}
+
+inline Vec operator+(Vec a, Vec b) {
+    return {_mm_add_pd(a.v, b.v)};
+}
+
+inline Vec operator-(Vec a, Vec b) {
+    return {_mm_sub_pd(a.v, b.v)};
+}
+
+inline Vec operator*(Vec a, Vec b) {
+    return {_mm_mul_pd(a.v, b.v)};
+}
+
+inline Vec operator/(Vec a, Vec b) {
+    return {_mm_div_pd(a.v, b.v)};
+}
+
+inline Vec min(Vec a, Vec b) {
+    return {_mm_min_pd(a.v, b.v)};
+}
+
+inline Vec max(Vec a, Vec b) {
+    return {_mm_max_pd(a.v, b.v)};
+}
+
+inline Vec sqrt(Vec a) {
+    return {_mm_sqrt_pd(a.v)};
+}
+
+inline Vec abs(Vec a) {
+    return {_mm_andnot_pd(_mm_set1_pd(-0.0), a.v)};
+}
+
+// SSE2 has no packed round; the conversion rounds to nearest under the default MXCSR mode.
+inline Vec round(Vec a) {
+    return {_mm_cvtepi32_pd(_mm_cvtpd_epi32(a.v))};
+}
+
+inline Vec pow2(Vec n) {
+    auto e = _mm_add_epi32(_mm_cvtpd_epi32(n.v), _mm_set1_epi32(1023));
+
+    // [e0, e1, 0, 0] -> [e0, 0, e1, 0]: two non-negative 64-bit lanes.
+    e = _mm_shuffle_epi32(e, _MM_SHUFFLE(3, 1, 2, 0));
+
+    return {_mm_castsi128_pd(_mm_slli_epi64(e, 52))};
+}
+
+inline Mask operator<(Vec a, Vec b) {
+    return {_mm_cmplt_pd(a.v, b.v)};
+}
+
+inline Mask operator>(Vec a, Vec b) {
+    return {_mm_cmpgt_pd(a.v, b.v)};
+}
+
+inline Mask operator&(Mask a, Mask b) {
+    return {_mm_and_pd(a.v, b.v)};
+}
+
+inline Mask operator|(Mask a, Mask b) {
+    return {_mm_or_pd(a.v, b.v)};
+}
+
+inline Mask operator!(Mask a) {
+    return {_mm_xor_pd(a.v, _mm_castsi128_pd(_mm_set1_epi32(-1)))};
+}
+
+inline Vec select(Mask mask, Vec a, Vec b) {
+    return {_mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v))};
+}
+
+inline bool all(Mask mask) {
+    return _mm_movemask_pd(mask.v) == 0x3;
+}
+
+#else
+
+struct Vec {
+    double v;
+
+    static constexpr std::size_t WIDTH = 1;
+};
+
+struct Mask {
+    bool v;
+};
+
+inline Vec set1(double x) {
+    return {x};
+}
+
+inline Vec load(const double *p) {
+    return {*p};
+}
+
+inline void store(double *p, Vec x) {
+    *p = x.v;
+}
+
+inline Vec operator+(Vec a, Vec b) {
+    return {a.v + b.v};
+}
+
+inline Vec operator-(Vec a, Vec b) {
+    return {a.v - b.v};
+}
+
+inline Vec operator*(Vec a, Vec b) {
+    return {a.v * b.v};
+}
+
+inline Vec operator/(Vec a, Vec b) {
+    return {a.v / b.v};
+}
+
+inline Vec min(Vec a, Vec b) {
+    return {b.v < a.v ? b.v : a.v};
+}
+
+inline Vec max(Vec a, Vec b) {
+    return {b.v > a.v ? b.v : a.v};
+}
+
+inline Vec sqrt(Vec a) {
+    return {std::sqrt(a.v)};
+}
+
+inline Vec abs(Vec a) {
+    return {std::fabs(a.v)};
+}
+
+inline Vec round(Vec a) {
+    return {std::nearbyint(a.v)};
+}
+
+inline Vec pow2(Vec n) {
+    return {std::ldexp(1.0, static_cast<int>(n.v))};
+}
+
+inline Mask operator<(Vec a, Vec b) {
+    return {a.v < b.v};
+}
+
+inline Mask operator>(Vec a, Vec b) {
+    return {a.v > b.v};
+}
+
+inline Mask operator&(Mask a, Mask b) {
+    return {a.v && b.v};
+}
+
+inline Mask operator|(Mask a, Mask b) {
+    return {a.v || b.v};
+}
+
+inline Mask operator!(Mask a) {
+    return {!a.v};
+}
+
+inline Vec select(Mask mask, Vec a, Vec b) {
+    return mask.v ? a : b;
+}
+
+inline bool all(Mask mask) {
+    return mask.v;
+}
+
+#endif
+
+// e^x, relative error ~1e-15. x is clamped to [-708, 708].
+inline Vec exp(Vec x) {
+    x = min(max(x, set1(-708.0)), set1(708.0));
+
+    // x = n * ln2 + r, |r| <= ln2 / 2; ln2 is split so that n * LN2_HI is exact.
+    auto n = round(x * set1(1.4426950408889634));
+    auto r = x - n * set1(6.93145751953125e-1) - n * set1(1.42860682030941723212e-6);
+
+    // Taylor series of e^r up to r^11 / 11!.
+    auto p = set1(1.0 / 39916800.0);
+
+    p = p * r + set1(1.0 / 3628800.0);
+    p = p * r + set1(1.0 / 362880.0);
+    p = p * r + set1(1.0 / 40320.0);
+    p = p * r + set1(1.0 / 5040.0);
+    p = p * r + set1(1.0 / 720.0);
+    p = p * r + set1(1.0 / 120.0);
+    p = p * r + set1(1.0 / 24.0);
+    p = p * r + set1(1.0 / 6.0);
+    p = p * r + set1(0.5);
+    p = p * r + set1(1.0);
+    p = p * r + set1(1.0);
+
+    return p * pow2(n);
+}
+
+// Standard normal density.
+inline Vec normalPdf(Vec x) {
+    return exp(x * x * set1(-0.5)) * set1(0.3989422804014327);
+}
+
+// Standard normal distribution function, absolute error ~1e-14 (Hart's rational approximation, with a continued
+// fraction in the tail).
+inline Vec normalCdf(Vec x) {
+    auto a = abs(x);
+    auto e = exp(a * a * set1(-0.5));
+
+    auto num = set1(3.52624965998911e-2);
+
+    num = num * a + set1(0.700383064443688);
+    num = num * a + set1(6.37396220353165);
+    num = num * a + set1(33.912866078383);
+    num = num * a + set1(112.079291497871);
+    num = num * a + set1(221.213596169931);
+    num = num * a + set1(220.206867912376);
+
+    auto den = set1(8.83883476483184e-2);
+
+    den = den * a + set1(1.75566716318264);
+    den = den * a + set1(16.064177579207);
+    den = den * a + set1(86.7807322029461);
+    den = den * a + set1(296.564248779674);
+    den = den * a + set1(637.333633378831);
+    den = den * a + set1(793.826512519948);
+    den = den * a + set1(440.413735824752);
+
+    auto cf = a + set1(0.65);
+
+    cf = a + set1(4.0) / cf;
+    cf = a + set1(3.0) / cf;
+    cf = a + set1(2.0) / cf;
+    cf = a + set1(1.0) / cf;
+
+    auto tail = select(a < set1(7.07106781186547), e * num / den, e / cf * set1(0.3989422804014327));
+
+    tail = select(a > set1(37.0), set1(0.0), tail);
+
+    return select(x > set1(0.0), set1(1.0) - tail, tail);
+}
+
+}// namespace vmath
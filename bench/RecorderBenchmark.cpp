@@ -0,0 +1,137 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+// Compares the tape recorder's file sinks: buffered stdio, io_uring and O_DIRECT.
+// Reports throughput (including the final drain on close) and the latency distribution of individual write() calls
+// as seen by the producing thread.
+//
+// Usage: RecorderBenchmark <directory> [megabytes = 512] [records per frame = 1]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../BinaryProtocol.hpp"
+#include "../DirectFileSink.hpp"
+#include "../UringFileSink.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static std::vector<char> makeFrame(std::uint32_t records) {
+    std::vector<char> frame(sizeof(binproto::FrameHeader) + records * sizeof(binproto::QuoteRecord));
+    binproto::FrameHeader header{};
+
+    header.magic = binproto::MAGIC;
+    header.frameType = binproto::FRAME_EVENTS;
+    header.eventType = binproto::EVENT_QUOTE;
+    header.count = records;
+    header.payloadSize = static_cast<std::uint32_t>(records * sizeof(binproto::QuoteRecord));
+    std::memcpy(frame.data(), &header, sizeof(header));
+
+    for (std::uint32_t i = 0; i < records; i++) {
+        binproto::QuoteRecord record{};
+
+        record.time = 1700000000000 + i;
+        record.bidPrice = 100.0 + i * 0.01;
+        record.askPrice = record.bidPrice + 0.02;
+        std::memcpy(frame.data() + sizeof(header) + i * sizeof(record), &record, sizeof(record));
+    }
+
+    return frame;
+}
+
+static double percentile(std::vector<std::uint32_t> &samples, double p) {
+    auto n = static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1));
+
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(n), samples.end());
+
+    return samples[n] / 1000.0;
+}
+
+static void run(const char *name, const std::function<std::unique_ptr<FileSink>()> &open, const std::vector<char> &frame,
+                std::uint64_t totalBytes) {
+    auto sink = open();
+
+    if (!sink) {
+        std::printf("%-10s unavailable\n", name);
+
+        return;
+    }
+
+    auto frames = totalBytes / frame.size();
+    std::vector<std::uint32_t> latencies{};
+
+    latencies.reserve(frames);
+
+    auto start = Clock::now();
+
+    for (std::uint64_t i = 0; i < frames; i++) {
+        auto before = Clock::now();
+
+        sink->write(frame.data(), frame.size());
+
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count();
+
+        latencies.push_back(static_cast<std::uint32_t>(std::min<long long>(nanos, UINT32_MAX)));
+    }
+
+    sink.reset();
+
+    auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    auto megabytes = static_cast<double>(frames * frame.size()) / (1 << 20);
+    auto max = *std::max_element(latencies.begin(), latencies.end()) / 1000.0;
+
+    std::printf("%-10s %9.1f MB/s  write() us: p50 %7.2f  p99 %7.2f  p99.9 %8.2f  p99.99 %9.2f  max %9.2f\n", name,
+                megabytes / seconds, percentile(latencies, 0.5), percentile(latencies, 0.99),
+                percentile(latencies, 0.999), percentile(latencies, 0.9999), max);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <directory> [megabytes = 512] [records per frame = 1]\n", argv[0]);
+
+        return 1;
+    }
+
+    std::string directory = argv[1];
+    std::uint64_t totalBytes = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 512) << 20;
+    auto records = static_cast<std::uint32_t>(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1);
+    auto frame = makeFrame(std::max<std::uint32_t>(records, 1));
+
+    // The latency percentiles need at least one write.
+    if (totalBytes < frame.size()) {
+        std::fprintf(stderr, "%s: %llu bytes do not hold a single %zu-byte frame\n", argv[0],
+                     static_cast<unsigned long long>(totalBytes), frame.size());
+
+        return 1;
+    }
+
+    run("buffered", [&] {
+        return StdioFileSink::open(directory + "/bench-buffered.tape", 1 << 20);
+    }, frame, totalBytes);
+
+#ifdef SUPDXFD_HAVE_IO_URING
+    run("io_uring", [&] {
+        return UringFileSink::open(directory + "/bench-uring.tape");
+    }, frame, totalBytes);
+#endif
+
+#if defined(__linux__)
+    run("direct", [&] {
+        return DirectFileSink::open(directory + "/bench-direct.tape");
+    }, frame, totalBytes);
+#endif
+
+    std::remove((directory + "/bench-buffered.tape").c_str());
+    std::remove((directory + "/bench-uring.tape").c_str());
+    std::remove((directory + "/bench-direct.tape").c_str());
+
+    return 0;
+}
@@ -1,10 +1,21 @@
 // Copyright (c) 2024 Devexperts LLC.
 // SPDX-License-Identifier: MPL-2.0
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -12,9 +23,46 @@
 #include <fmt/chrono.h>
 #include <fmt/format.h>
 
+#include <sys/stat.h>
+
 #include <DXErrorCodes.h>
 #include <DXFeed.h>
 
+#include "Backfill.hpp"
+#include "BasketEngine.hpp"
+#include "BinaryWriter.hpp"
+#include "ChainWindows.hpp"
+#include "CompressingFileSink.hpp"
+#include "ControlPacer.hpp"
+#include "ControlServer.hpp"
+#include "CurrencyGraph.hpp"
+#include "Dashboard.hpp"
+#include "DispatchLanes.hpp"
+#include "EventRing.hpp"
+#include "EventTimeline.hpp"
+#include "DirectFileSink.hpp"
+#include "HistoryQuery.hpp"
+#include "InstrumentProfiles.hpp"
+#include "OptionChains.hpp"
+#include "OutputPolicy.hpp"
+#include "PeriodicTasks.hpp"
+#include "Pipeline.hpp"
+#include "Probes.hpp"
+#include "StageTrace.hpp"
+#include "StaleQuoteMonitor.hpp"
+#include "SymbolUniverse.hpp"
+#include "TapeRecorder.hpp"
+#include "TradeClassifier.hpp"
+#include "UringFileSink.hpp"
+
+#ifdef _WIN32
+#    include <fcntl.h>
+#    include <io.h>
+#else
+#    include <poll.h>
+#    include <unistd.h>
+#endif
+
 #ifdef _MSC_FULL_VER
 #pragma warning(push)
 #pragma warning(disable : 4244)
@@ -73,7 +121,7 @@ inline std::string formatTimestampWithMillis(long long timestamp) {
 namespace detail {
     template<typename F>
     constexpr auto onScopeExitImpl(F &&f) {
-        auto onExit = [&f](auto) { f(); };
+        auto onExit = [f](auto) { f(); };
 
         return std::shared_ptr<void>(nullptr, onExit);
     }
@@ -119,6 +167,47 @@ inline dxf_const_string_t orderSideToString(dxf_order_side_t side) {
 
 std::recursive_mutex ioMutex{};
 
+enum class OutputMode { TEXT,
+                        BINARY,
+                        DASHBOARD };
+
+OutputMode outputMode{OutputMode::TEXT};
+
+std::unique_ptr<BinaryWriter> binaryWriter{};
+std::unique_ptr<QuoteHistory> quoteHistory{};
+std::unique_ptr<TopOfBook> topOfBook{};
+std::unique_ptr<StaleQuoteMonitor> staleQuoteMonitor{};
+std::unique_ptr<FileSink> textLog{};
+std::unique_ptr<TapeRecorder> tapeRecorder{};
+std::unique_ptr<TradeClassifier> tradeClassifier{};
+std::unique_ptr<OptionChains> optionChains{};
+std::unique_ptr<BasketEngine> basketEngine{};
+std::unique_ptr<CurrencyGraph> currencyGraph{};
+std::unique_ptr<EventTimeline> eventTimeline{};
+std::unique_ptr<ChainWindows> chainWindows{};
+
+// A text log attached and detached over the control socket while the lanes are running.
+struct AttachedSink {
+    std::mutex mutex{};
+    std::unique_ptr<FileSink> sink{};
+};
+
+std::unique_ptr<AttachedSink> attachedSink{};
+std::unique_ptr<StageTracer> stageTracer{};
+
+// Declared last so that they are destroyed first: their consumers use the objects above.
+std::unique_ptr<Dispatcher> dispatcher{};
+std::unique_ptr<EventRing> eventRing{};
+
+// In binary and dashboard modes stdout is owned by the output, so all diagnostics are redirected to stderr.
+inline std::wostream &diagnostics() {
+    return outputMode == OutputMode::TEXT ? std::wcout : std::wcerr;
+}
+
+inline std::FILE *logFile() {
+    return outputMode == OutputMode::TEXT ? stdout : stderr;
+}
+
 inline void processLastError() {
     std::lock_guard<std::recursive_mutex> lock{ioMutex};
 
@@ -129,35 +218,246 @@ inline void processLastError() {
 
     if (res == DXF_SUCCESS) {
         if (errorCode == dx_ec_success) {
-            std::wcout << L"No error information is stored" << std::endl;
+            diagnostics() << L"No error information is stored" << std::endl;
 
             return;
         }
 
-        std::wcout << L"Error occurred and successfully retrieved:\nerror code = " << errorCode << ", description = \""
-                   << errorDescription << "\"" << std::endl;
+        diagnostics() << L"Error occurred and successfully retrieved:\nerror code = " << errorCode
+                      << ", description = \"" << errorDescription << "\"" << std::endl;
 
         return;
     }
 
-    std::wcout << L"An error occurred but the error subsystem failed to initialize" << std::endl;
+    diagnostics() << L"An error occurred but the error subsystem failed to initialize" << std::endl;
+}
+
+inline std::string formatQuote(std::size_t id, std::size_t listenerId, dxf_const_string_t symbolName,
+                               const dxf_quote_t &q) {
+    return fmt::format("Sub[{}]: Listener[{}]: Quote{{symbol = {}, sequence = {}, bidTime = {}, bidExchangeCode = {}, "
+                       "bidPrice = {}, bidSize={}, askTime = {}, askExchangeCode = {}, askPrice = {}, askSize={}, "
+                       "scope = {}}}\n",
+                       id, listenerId, StringConverter::toString(symbolName), q.sequence,
+                       formatTimestampWithMillis<LOCAL>(q.bid_time), StringConverter::toString(q.bid_exchange_code),
+                       q.bid_price, q.bid_size, formatTimestampWithMillis<LOCAL>(q.ask_time),
+                       StringConverter::toString(q.ask_exchange_code), q.ask_price, q.ask_size,
+                       StringConverter::toString(orderScopeToString(q.scope)));
+}
+
+inline std::string formatTrade(std::size_t id, std::size_t listenerId, dxf_const_string_t symbolName,
+                               const dxf_trade_t &t, const TradeClassification *classification) {
+    auto text = fmt::format("Sub[{}]: Listener[{}]: Trade{{symbol = {}, time = {}, exchangeCode = {}, price = {}, "
+                            "size = {}, dayVolume = {}, scope = {}",
+                            id, listenerId, StringConverter::toString(symbolName), formatTimestampWithMillis<LOCAL>(t.time),
+                            StringConverter::toString(t.exchange_code), t.price, t.size, t.day_volume,
+                            StringConverter::toString(orderScopeToString(t.scope)));
+
+    if (classification) {
+        text += fmt::format(", side = {}", aggressorSideToString(classification->side));
+
+        if (classification->rule == TradeRule::QUOTE) {
+            text += ", rule = quote";
+        } else if (classification->rule == TradeRule::TICK) {
+            text += ", rule = tick";
+        }
+
+        if (classification->hasQuote) {
+            text += fmt::format(", bid = {}, ask = {}", classification->quote.bidPrice, classification->quote.askPrice);
+        }
+    }
+
+    return text + "}\n";
 }
 
 using ListenerType = void(int /*eventType*/, dxf_const_string_t /*symbolName*/, const dxf_event_data_t * /*data*/,
                           int /*dataCount*/, void * /*userData*/);
 using ListenerPtrType = std::add_pointer_t<ListenerType>;
 
+// One listener call on its way through the listener pipeline. The events are the C API's, valid during the call only.
+struct ListenerCall {
+    int eventType{0};
+    dxf_const_string_t symbol{nullptr};
+    const dxf_event_data_t *data{nullptr};
+    int count{0};
+    std::size_t listenerId{0};
+    void (*print)(const EventBatch &batch){nullptr};
+    std::uint32_t symbolId{SymbolTable::INVALID_ID};
+    const std::vector<TradeClassification> *classifications{nullptr};
+    std::uint64_t traceIntake{0};// zero if not sampled
+};
+
+// Drops empty calls and event types that nothing consumes.
+struct AcceptStage {
+    static const char *name() {
+        return "accept";
+    }
+
+    bool operator()(ListenerCall &call) const {
+        return call.count > 0 &&
+               (call.eventType == DXF_ET_QUOTE || call.eventType == DXF_ET_TRADE || call.eventType == DXF_ET_ORDER);
+    }
+};
+
+struct InternStage {
+    static const char *name() {
+        return "intern";
+    }
+
+    bool operator()(ListenerCall &call) const {
+        call.symbolId = globalSymbols().intern(call.symbol).first;
+
+        return true;
+    }
+};
+
+// The quote history is appended inline: trade classification looks up the prevailing quote in it.
+struct HistoryStage {
+    static const char *name() {
+        return "history";
+    }
+
+    bool operator()(ListenerCall &call) const {
+        if (quoteHistory && call.eventType == DXF_ET_QUOTE) {
+            quoteHistory->append(call.symbolId, reinterpret_cast<const dxf_quote_t *>(call.data), call.count);
+        }
+
+        return true;
+    }
+};
+
+struct ClassifyStage {
+    static const char *name() {
+        return "classify";
+    }
+
+    bool operator()(ListenerCall &call) const {
+        if (!tradeClassifier || call.eventType != DXF_ET_TRADE) {
+            return true;
+        }
+
+        // Per listener thread, so that listeners of several connections do not share it.
+        thread_local std::vector<TradeClassification> classifications{};
+        auto trades = reinterpret_cast<const dxf_trade_t *>(call.data);
+
+        classifications.resize(static_cast<std::size_t>(call.count));
+
+        for (int i = 0; i < call.count; i++) {
+            classifications[i] = tradeClassifier->classify(call.symbolId, trades[i]);
+        }
+
+        call.classifications = &classifications;
+
+        return true;
+    }
+};
+
+// The thread boundary: copies the call into a batch, in place in a ring slot or as a new batch shared by the
+// dispatch lanes, and leaves the rest to the consumers.
+struct FanoutStage {
+    static const char *name() {
+        return "fanout";
+    }
+
+    static void fill(const ListenerCall &call, EventBatch &batch) {
+        batch.symbol = call.symbol;
+        batch.symbolId = call.symbolId;
+        batch.listenerId = call.listenerId;
+        batch.print = call.print;
+        batch.classifications.clear();
+        batch.aggressorSides.clear();
+
+        if (call.eventType == DXF_ET_QUOTE) {
+            batch.assign(DXF_ET_QUOTE, reinterpret_cast<const dxf_quote_t *>(call.data), call.count);
+        } else if (call.eventType == DXF_ET_TRADE) {
+            batch.assign(DXF_ET_TRADE, reinterpret_cast<const dxf_trade_t *>(call.data), call.count);
+        } else {
+            batch.assign(DXF_ET_ORDER, reinterpret_cast<const dxf_order_t *>(call.data), call.count);
+        }
+
+        if (call.classifications) {
+            batch.classifications = *call.classifications;
+
+            for (auto &c : batch.classifications) {
+                batch.aggressorSides.push_back(c.side);
+            }
+        }
+
+        batch.traceIntake = call.traceIntake;
+        batch.traceCopied = 0;
+
+        if (call.traceIntake != 0) {
+            static const auto copyOut = stageTracer->segment("copy-out");
+
+            batch.traceCopied = traceTicks();
+            stageTracer->record(copyOut, batch.traceIntake, batch.traceCopied);
+        }
+    }
+
+    bool operator()(ListenerCall &call) const {
+        if (eventRing) {
+            return eventRing->publish([&call](EventBatch &batch) {
+                fill(call, batch);
+            });
+        }
+
+        if (!dispatcher->hasConsumers()) {
+            return true;
+        }
+
+        auto batch = std::make_shared<EventBatch>();
+
+        fill(call, *batch);
+        dispatcher->publish(batch);
+
+        return true;
+    }
+};
+
+using ListenerPipeline = Pipeline<AcceptStage, InternStage, HistoryStage, ClassifyStage, FanoutStage>;
+
+inline ListenerPipeline &listenerPipeline() {
+    static ListenerPipeline pipeline{};
+
+    return pipeline;
+}
+
+// Stage reports of the consumer pipelines, registered with them before the fanout starts.
+inline std::vector<std::function<void(std::string &)>> &consumerPipelineReports() {
+    static std::vector<std::function<void(std::string &)>> reports{};
+
+    return reports;
+}
+
+inline std::string consumerPipelinesReport() {
+    std::string text{};
+
+    for (auto &report : consumerPipelineReports()) {
+        report(text);
+    }
+
+    return text;
+}
+
 struct SubscriptionBase {
     virtual ~SubscriptionBase() = default;
     virtual void Close() = 0;
+    virtual void setOutputPolicy(const OutputPolicyConfig &config) = 0;
+    // Prints the summary of suppressed console output if its period has elapsed, or in any case if `last`.
+    virtual void printSummary(bool last) = 0;
 };
 
 template <typename F, typename... Args>
 void log(F&& format, Args&&... args) {
     std::lock_guard<std::recursive_mutex> lock{ioMutex};
-    fmt::print(format, args...);
+    fmt::print(logFile(), format, args...);
 }
 
+struct SubscriptionOptions {
+    int eventTypes{DXF_ET_QUOTE};
+    OutputPolicyConfig outputPolicy{};
+    ControlPacer *pacer{nullptr};// the connection's, if its control calls are paced
+};
+
 template<std::size_t id>
 struct Subscription : public SubscriptionBase {
     std::recursive_mutex mutex{};
@@ -165,18 +465,39 @@ struct Subscription : public SubscriptionBase {
     dxf_const_string_t symbol{nullptr};
     dxf_subscription_t handle{nullptr};
     ERRORCODE errorCode{DXF_SUCCESS};
+    ControlPacer *pacer{nullptr};
 
-    Subscription(dxf_connection_t connection, dxf_const_string_t symbol) : connection(connection), symbol(symbol) {
-        log("Sub[id = {}]: Creating a subscription\n", id);
+    // Makes a call that reaches the upstream, through the pacer if there is one.
+    ERRORCODE control(const ControlPacer::Call &call) {
+        if (pacer) {
+            return pacer->call(call) ? DXF_SUCCESS : DXF_FAILURE;
+        }
 
-        errorCode = dxf_create_subscription(connection, DXF_ET_QUOTE, &handle);
+        auto result = call();
 
-        if (errorCode == DXF_FAILURE) {
+        if (result == DXF_FAILURE) {
             processLastError();
+        }
+
+        return result;
+    }
 
+    Subscription(dxf_connection_t connection, dxf_const_string_t symbol,
+                 const SubscriptionOptions &options = SubscriptionOptions{})
+        : connection(connection), symbol(symbol), pacer(options.pacer) {
+        outputPolicy().configure(options.outputPolicy);
+
+        log("Sub[id = {}]: Creating a subscription\n", id);
+
+        errorCode = control([this, &options] {
+            return dxf_create_subscription(this->connection, options.eventTypes, &handle);
+        });
+
+        if (errorCode == DXF_FAILURE) {
             return;
         }
 
+        SUPDXFD_PROBE2(subscription__create, std::size_t{id}, (void *) handle);
         log("Sub[id = {}, handle = {}]: Attaching the listener: {}\n", id, (void*)handle, (void *) getListener());
 
         errorCode = dxf_attach_event_listener(handle, getListener(), (void *) (std::size_t{id}));
@@ -187,25 +508,101 @@ struct Subscription : public SubscriptionBase {
             return;
         }
 
+        // Subscriptions without an initial symbol get theirs through addSymbols().
+        if (!symbol) {
+            return;
+        }
+
         log("Sub[id = {}, handle = {}]: Adding the symbol: {}\n", id, (void*)handle, StringConverter::toString(symbol));
 
-        errorCode = dxf_add_symbol(handle, symbol);
+        errorCode = control([this] {
+            return dxf_add_symbol(handle, this->symbol);
+        });
+    }
 
-        if (errorCode == DXF_FAILURE) {
+    // Adds or removes a batch of symbols; a failed call does not invalidate the subscription. With a pacer the change
+    // is only queued, and the future becomes ready once it has been made.
+    std::future<bool> addSymbols(const std::vector<std::wstring> &symbols) {
+        return changeSymbols(symbols, true);
+    }
+
+    std::future<bool> removeSymbols(const std::vector<std::wstring> &symbols) {
+        return changeSymbols(symbols, false);
+    }
+
+    std::future<bool> changeSymbols(const std::vector<std::wstring> &symbols, bool add) {
+        std::lock_guard<std::recursive_mutex> lock{mutex};
+
+        if (!handle || errorCode != DXF_SUCCESS) {
+            return readyFuture(false);
+        }
+
+        if (symbols.empty()) {
+            return readyFuture(true);
+        }
+
+        log("Sub[id = {}, handle = {}]: {} {} symbols\n", id, (void *) handle, add ? "Adding" : "Removing",
+            symbols.size());
+        SUPDXFD_PROBE3(subscription__symbols, std::size_t{id}, add ? 1 : 0, symbols.size());
+
+        if (pacer) {
+            return pacer->changeSymbols(handle, add, symbols);
+        }
+
+        std::vector<dxf_const_string_t> names{};
+
+        for (auto &s : symbols) {
+            names.push_back(s.c_str());
+        }
+
+        auto result = add ? dxf_add_symbols(handle, names.data(), static_cast<int>(names.size()))
+                          : dxf_remove_symbols(handle, names.data(), static_cast<int>(names.size()));
+
+        if (result == DXF_FAILURE) {
             processLastError();
+
+            return readyFuture(false);
         }
+
+        return readyFuture(true);
     }
 
     static inline ListenerPtrType getListener() {
         static ListenerPtrType l = [](int eventType, dxf_const_string_t symbolName, const dxf_event_data_t *data,
                                       int dataCount, void *userData) {
-            std::lock_guard<std::recursive_mutex> lock{ioMutex};
+            ListenerCall call{};
+
+            call.eventType = eventType;
+            call.symbol = symbolName;
+            call.data = data;
+            call.count = dataCount;
+            call.listenerId = (std::size_t) userData;
+            call.print = &Subscription::print;
+            call.traceIntake = stageTracer ? stageTracer->sample() : 0;
+            SUPDXFD_PROBE3(listener__entry, call.listenerId, eventType, dataCount);
+            listenerPipeline()(call);
+            SUPDXFD_PROBE3(listener__return, call.listenerId, eventType, dataCount);
+        };
 
-            std::wcout << "Sub[" << id << "]: Listener[" << (std::size_t) userData << "]: ";
+        return l;
+    }
+
+    // Console output in text mode, on a bulk lane.
+    static void print(const EventBatch &batch) {
+        std::lock_guard<std::recursive_mutex> lock{ioMutex};
+        auto symbolName = batch.symbol.c_str();
+
+        if (batch.eventType == DXF_ET_QUOTE) {
+            auto quotes = batch.events<dxf_quote_t>();
 
-            if (eventType == DXF_ET_QUOTE) {
-                auto *q = (dxf_quote_t *) data;
+            for (int i = 0; i < batch.count; i++) {
+                auto *q = &quotes[i];
 
+                if (!outputPolicy().admit(batch.symbolId, DXF_ET_QUOTE, q->bid_price, q->ask_price)) {
+                    continue;
+                }
+
+                std::wcout << "Sub[" << id << "]: Listener[" << batch.listenerId << "]: ";
                 std::wcout << L"Quote{symbol = " << symbolName;
                 std::wcout << L", sequence = " << q->sequence;
                 std::wcout << L", bidTime = ";
@@ -216,21 +613,52 @@ struct Subscription : public SubscriptionBase {
                 std::wcout << L", askExchangeCode = " << q->ask_exchange_code << ", askPrice = " << q->bid_price << ", askSize=" << q->bid_size << ", ";
                 std::wcout << L"scope = " << orderScopeToString(q->scope) << "}" << std::endl;
             }
-        };
+        } else if (batch.eventType == DXF_ET_TRADE) {
+            auto trades = batch.events<dxf_trade_t>();
+            auto classified = batch.classified();
 
-        return l;
+            for (int i = 0; i < batch.count; i++) {
+                if (!outputPolicy().admit(batch.symbolId, DXF_ET_TRADE, trades[i].price, trades[i].price)) {
+                    continue;
+                }
+
+                auto line = formatTrade(id, batch.listenerId, symbolName, trades[i],
+                                        classified ? &classified[i] : nullptr);
+
+                std::wcout << StringConverter::toWString(line).c_str() << std::flush;
+            }
+        }
+    }
+
+    void printSummary(bool last) override {
+        std::string summary{};
+
+        if (outputPolicy().takeSummary(summary, globalSymbols(), last)) {
+            std::lock_guard<std::recursive_mutex> lock{ioMutex};
+
+            std::wcout << "Sub[" << id << "]: " << StringConverter::toWString(summary).c_str() << std::endl;
+        }
+    }
+
+    // Listener state is per subscription type, as is the listener itself.
+    static OutputPolicy &outputPolicy() {
+        static OutputPolicy policy{};
+
+        return policy;
     }
 
     void CloseImpl() {
         if (handle && errorCode == DXF_SUCCESS) {
-            log("Sub[id = {}, handle = {}]: Removing the symbol: {}\n", id, (void*)handle, StringConverter::toString(symbol));
+            if (symbol) {
+                log("Sub[id = {}, handle = {}]: Removing the symbol: {}\n", id, (void*)handle, StringConverter::toString(symbol));
 
-            errorCode = dxf_remove_symbol(handle, symbol);
+                errorCode = control([this] {
+                    return dxf_remove_symbol(handle, symbol);
+                });
 
-            if (errorCode == DXF_FAILURE) {
-                processLastError();
-
-                return;
+                if (errorCode == DXF_FAILURE) {
+                    return;
+                }
             }
 
             log("Sub[id = {}, handle = {}]: Detaching the listener: {}\n", id, (void*)handle, (void *) getListener());
@@ -244,13 +672,11 @@ struct Subscription : public SubscriptionBase {
             }
 
             log("Sub[id = {}, handle = {}]: Closing the subscription\n", id, (void*)handle);
+            SUPDXFD_PROBE2(subscription__close, std::size_t{id}, (void *) handle);
 
-            errorCode = dxf_close_subscription(handle);
-
-            if (errorCode == DXF_FAILURE) {
-                processLastError();
-            }
-
+            errorCode = control([this] {
+                return dxf_close_subscription(handle);
+            });
             handle = nullptr;
         }
     }
@@ -260,60 +686,1340 @@ struct Subscription : public SubscriptionBase {
         CloseImpl();
     }
 
+    void setOutputPolicy(const OutputPolicyConfig &config) override {
+        outputPolicy().configure(config);
+    }
+
     ~Subscription() override {
         CloseImpl();
     }
 };
 
+inline void runHistoryQuery(HistoryQueryEngine &engine, const std::string &line) {
+    if (line.empty()) {
+        return;
+    }
 
-int main() {
-    dxf_initialize_logger_v2("SUPDXFD-17424.log", true, true, true, false);
-    dxf_load_config_from_string("logger.level = \"debug\"\n");
-    auto symbol = L"ETH/USD";
+    HistoryQuery query{};
+    std::string error{};
 
-    dxf_connection_t c{};
+    if (!HistoryQuery::parse(line, query, error)) {
+        log("Query: {}\n", error);
 
-    auto result = dxf_create_connection("demo.dxfeed.com:7300", nullptr, nullptr, nullptr, nullptr, nullptr, &c);
+        return;
+    }
 
-    if (result == DXF_FAILURE) {
-        processLastError();
+    log("Query: {}\n{}", line, engine.runToText(query));
+}
 
-        return 1;
+#ifndef _WIN32
+// Reads history queries from stdin, one per line, and prints the results until the input ends or `running` is
+// cleared. Runs on its own thread and only takes per-symbol snapshots, so ingestion keeps going while a query is
+// scanned. Stdin is polled instead of read blocking, so that main can join the thread before the history is destroyed.
+inline void runHistoryQueries(QuoteHistory &history, std::atomic<bool> &running) {
+    HistoryQueryEngine engine{history};
+    std::string input{};
+    char buffer[4096];
+
+    while (running) {
+        pollfd in{STDIN_FILENO, POLLIN, 0};
+        auto ready = poll(&in, 1, 200);
+
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+
+        if (ready <= 0) {
+            continue;
+        }
+
+        auto n = read(STDIN_FILENO, buffer, sizeof(buffer));
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            runHistoryQuery(engine, input);
+
+            return;
+        }
+
+        input.append(buffer, static_cast<std::size_t>(n));
+
+        for (auto eol = input.find('\n'); eol != std::string::npos; eol = input.find('\n')) {
+            auto line = input.substr(0, eol);
+
+            input.erase(0, eol + 1);
+            runHistoryQuery(engine, line);
+        }
     }
+}
+#endif
 
-    onScopeExit([&c] {
-        auto result = dxf_close_connection(c);
+inline std::string formatTimelineEvent(const TimelineEvent &e) {
+    auto text = fmt::format("Timeline[{}]: {} {} time = {}{:06}{}", e.intake,
+                            StringConverter::toString(globalSymbols().name(e.symbolId)),
+                            timelineEventTypeToString(e.type), formatTimestampWithMillis<LOCAL>(e.timeNanos / 1000000),
+                            e.timeNanos % 1000000, e.late ? " (late)" : "");
+
+    switch (e.type) {
+        case TimelineEventType::QUOTE:
+            return text + fmt::format(", bid = {}, ask = {}\n", e.quote.bid_price, e.quote.ask_price);
+        case TimelineEventType::TRADE:
+            return text + fmt::format(", price = {}, size = {}\n", e.trade.price, e.trade.size);
+        case TimelineEventType::ORDER:
+            return text + fmt::format(", side = {}, price = {}, size = {}\n",
+                                      e.order.side == dxf_osd_buy ? "Buy" : "Sell", e.order.price, e.order.size);
+    }
 
-        if (result == DXF_FAILURE) {
-            processLastError();
+    return text + "\n";
+}
+
+// Reads one symbol per line, skipping blank lines; returns false if the file cannot be opened.
+inline bool readSymbolFile(const std::string &path, std::vector<std::wstring> &symbols) {
+    std::ifstream in{path};
+    std::string line{};
+
+    if (!in) {
+        return false;
+    }
+
+    while (std::getline(in, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+
+        if (!line.empty()) {
+            symbols.push_back(StringConverter::toWString(line));
         }
-    });
+    }
 
-    std::vector<std::unique_ptr<SubscriptionBase>> subs{};
+    return true;
+}
 
-    subs.emplace_back(new Subscription<1>(c, symbol));
+inline std::vector<std::wstring> readSymbolFile(const std::string &path) {
+    std::vector<std::wstring> symbols{};
 
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    readSymbolFile(path, symbols);
 
-    subs.emplace_back(new Subscription<2>(c, symbol));
+    return symbols;
+}
 
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+// Modification time in ns, so that two edits within a second are told apart where the platform records it.
+inline long long modificationNanos(const struct stat &st) {
+#if defined(_WIN32)
+    return static_cast<long long>(st.st_mtime) * 1000000000LL;
+#elif defined(__APPLE__)
+    return static_cast<long long>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
 
-    subs.emplace_back(new Subscription<3>(c, symbol));
+// Re-reads the universe file whenever it changes and applies only the difference to the subscription's symbols. A
+// read that fails, or during which the file changed (e.g. caught half-rewritten), is discarded and retried on the
+// next poll rather than applied; writers should still replace the file by writing a new one and renaming it.
+template<typename S>
+void watchUniverse(const std::string &path, std::chrono::seconds poll, S *subscription, std::atomic<bool> &running) {
+    SymbolUniverse universe{globalSymbols()};
+    auto add = [subscription](const std::vector<std::wstring> &batch) {
+        return subscription->addSymbols(batch);
+    };
+    auto remove = [subscription](const std::vector<std::wstring> &batch) {
+        return subscription->removeSymbols(batch);
+    };
+    long long lastModified = -1;
+    long long lastSize = -1;
+
+    while (running) {
+        struct stat before {};
+        struct stat after {};
+        std::vector<std::wstring> desired{};
+
+        if (stat(path.c_str(), &before) == 0 &&
+            (modificationNanos(before) != lastModified || before.st_size != lastSize) &&
+            readSymbolFile(path, desired) && stat(path.c_str(), &after) == 0 &&
+            modificationNanos(after) == modificationNanos(before) && after.st_size == before.st_size) {
+            lastModified = modificationNanos(before);
+            lastSize = before.st_size;
+
+            auto diff = universe.reconcile(desired, add, remove);
+
+            log("Universe: {} added, {} removed, {} live\n", diff.added.size(), diff.removed.size(), universe.size());
+        }
 
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::this_thread::sleep_for(poll);
+    }
+}
 
-    subs.emplace_back(new Subscription<4>(c, symbol));
+// Moves the option subscription whenever a chain window moves. The windows themselves move on the dispatch lane; the
+// subscription calls are made here so that the lane never waits on the API.
+template<typename S>
+void maintainChainWindows(S *subscription, std::atomic<bool> &running) {
+    auto add = [subscription](const std::vector<std::wstring> &batch) {
+        return subscription->addSymbols(batch);
+    };
+    auto remove = [subscription](const std::vector<std::wstring> &batch) {
+        return subscription->removeSymbols(batch);
+    };
+
+    while (running) {
+        if (chainWindows->waitForMove(std::chrono::milliseconds(200))) {
+            auto diff = chainWindows->apply(add, remove);
+
+            log("Chain windows: {} added, {} removed\n{}", diff.added.size(), diff.removed.size(),
+                chainWindows->toText());
+        }
+    }
+}
 
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+// Commands of the control socket, run on its thread. Symbols are added to and removed from a subscription of their
+// own, as a difference applied in batches; the data path is never touched.
+template<typename S>
+class ControlCommands {
+    S *subscription;
+    const std::vector<std::unique_ptr<SubscriptionBase>> &subs;
+    OutputPolicyConfig policy;
+    std::set<std::wstring> symbols{};
+    SymbolUniverse universe{globalSymbols()};
+
+    std::string applySymbols() {
+        auto diff = universe.reconcile(
+            std::vector<std::wstring>(symbols.begin(), symbols.end()),
+            [this](const std::vector<std::wstring> &batch) {
+                return subscription->addSymbols(batch);
+            },
+            [this](const std::vector<std::wstring> &batch) {
+                return subscription->removeSymbols(batch);
+            });
+
+        return fmt::format("OK: {} added, {} removed, {} live\n", diff.added.size(), diff.removed.size(),
+                           universe.size());
+    }
 
-    subs.emplace_back(new Subscription<5>(c, symbol));
+    std::string attach(const std::string &path) {
+        std::unique_ptr<FileSink> sink{};
 
-    std::this_thread::sleep_for(std::chrono::seconds(3));
+        if (!path.empty()) {
+            sink = openFileSink(path, false);
 
-    subs[2]->Close();
+            if (!sink) {
+                return "ERROR: cannot open " + path + "\n";
+            }
+        }
 
-    std::this_thread::sleep_for(std::chrono::seconds(5));
+        std::lock_guard<std::mutex> lock{attachedSink->mutex};
+
+        if (attachedSink->sink) {
+            attachedSink->sink->flush();
+        }
+
+        attachedSink->sink = std::move(sink);
+
+        return path.empty() ? "OK: detached\n" : "OK: attached " + path + "\n";
+    }
+
+  public:
+    ControlCommands(S *subscription, const std::vector<std::unique_ptr<SubscriptionBase>> &subs,
+                    const OutputPolicyConfig &policy)
+        : subscription(subscription), subs(subs), policy(policy) {
+    }
+
+    std::string operator()(const std::string &line) {
+        std::istringstream words{line};
+        std::string command{};
+        std::vector<std::string> args{};
+
+        words >> command;
+
+        for (std::string arg{}; words >> arg;) {
+            args.push_back(arg);
+        }
+
+        if (command == "add" || command == "remove") {
+            for (auto &a : args) {
+                if (command == "add") {
+                    symbols.insert(StringConverter::toWString(a));
+                } else {
+                    symbols.erase(StringConverter::toWString(a));
+                }
+            }
+
+            return applySymbols();
+        } else if (command == "symbols") {
+            std::string text{};
+
+            for (auto &symbol : symbols) {
+                text += StringConverter::toString(symbol) + "\n";
+            }
+
+            return text + fmt::format("OK: {} symbols\n", symbols.size());
+        } else if (command == "policy" && args.size() == 1) {
+            auto config = policy;
+
+            if (!parseOutputPolicy(args[0], config)) {
+                return "ERROR: invalid output policy " + args[0] + "\n";
+            }
+
+            policy = config;
+
+            for (auto &sub : subs) {
+                sub->setOutputPolicy(policy);
+            }
+
+            return "OK: output policy " + args[0] + "\n";
+        } else if (command == "attach" && args.size() == 1) {
+            return attach(args[0]);
+        } else if (command == "detach") {
+            return attach("");
+        } else if (command == "stats") {
+            auto text = eventRing ? eventRing->stats() : dispatcher->stats();
+
+            text += listenerPipeline().report();
+            text += consumerPipelinesReport();
+
+            if (stageTracer) {
+                text += stageTracer->toText();
+            }
+
+            return text + "OK\n";
+        }
+
+        return "ERROR: commands are add <symbols>, remove <symbols>, symbols, policy <all|sample:N|rate:K|change>, "
+               "attach <file>, detach, stats\n";
+    }
+};
+
+// "STOCK 1200, OPTION 56000, ..."
+inline std::string countProfileTypes(const InstrumentProfiles &profiles) {
+    std::vector<std::size_t> counts(profiles.typeNames().size(), 0);
+    std::string text{};
+
+    for (auto &p : profiles.all()) {
+        counts[p.type]++;
+    }
+
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] != 0) {
+            text += fmt::format("{}{} {}", text.empty() ? "" : ", ", profiles.typeName(static_cast<std::uint16_t>(i)),
+                                counts[i]);
+        }
+    }
+
+    return text;
+}
+
+// The backfill is reported as a pseudo-subscription in text output.
+constexpr std::size_t backfillId = 10;
+
+// Backfilled and then live trade prints go to the same outputs as trades.
+inline void writeBackfill(dxf_const_string_t symbolName, const dxf_time_and_sale_t *events, int count) {
+    std::vector<dxf_trade_t> trades(static_cast<std::size_t>(count));
+    std::vector<std::uint8_t> sides(static_cast<std::size_t>(count));
+
+    for (int i = 0; i < count; i++) {
+        trades[i] = tradeFromTimeAndSale(events[i], sides[i]);
+    }
+
+    if (tapeRecorder) {
+        tapeRecorder->recordTrades(symbolName, trades.data(), count, sides.data());
+    }
+
+    if (outputMode == OutputMode::BINARY) {
+        binaryWriter->writeTrades(symbolName, trades.data(), count, sides.data());
+    } else if (outputMode == OutputMode::TEXT) {
+        std::string lines{};
+        TradeClassification classification{};
+
+        for (int i = 0; i < count; i++) {
+            classification.side = static_cast<binproto::AggressorSide>(sides[i]);
+            lines += formatTrade(backfillId, backfillId, symbolName, trades[i], &classification);
+        }
+
+        std::lock_guard<std::recursive_mutex> lock{ioMutex};
+
+        std::wcout << StringConverter::toWString(lines).c_str() << std::flush;
+    }
+}
+
+// Text log lines of a batch of quotes or trades.
+inline std::string formatBatch(const EventBatch &b) {
+    std::string lines{};
+
+    if (b.eventType == DXF_ET_QUOTE) {
+        for (int i = 0; i < b.count; i++) {
+            lines += formatQuote(b.listenerId, b.listenerId, b.symbol.c_str(), b.events<dxf_quote_t>()[i]);
+        }
+    } else if (b.eventType == DXF_ET_TRADE) {
+        for (int i = 0; i < b.count; i++) {
+            lines += formatTrade(b.listenerId, b.listenerId, b.symbol.c_str(), b.events<dxf_trade_t>()[i],
+                                 b.classified() ? &b.classified()[i] : nullptr);
+        }
+    }
+
+    return lines;
+}
+
+// Hands what the file outputs have buffered over to the OS, so that an output whose events have stopped does not keep
+// the last of them in memory.
+inline void flushFileOutputs() {
+    if (textLog) {
+        textLog->flush();
+    }
+
+    if (tapeRecorder) {
+        tapeRecorder->flush();
+    }
+
+    if (attachedSink) {
+        std::lock_guard<std::mutex> lock{attachedSink->mutex};
+
+        if (attachedSink->sink) {
+            attachedSink->sink->flush();
+        }
+    }
+}
+
+// Registers a consumer. With stage tracing, the sampled batches it consumes are timed from copy-out to the start of
+// the consumer ("queue") and through it ("handler").
+template<typename Fanout>
+void addConsumer(Fanout &d, const std::string &name, LanePriority priority, Dispatcher::Consumer consumer,
+                 std::chrono::microseconds latencyTarget = std::chrono::microseconds(0)) {
+    if (!stageTracer) {
+        d.addConsumer(name, priority, std::move(consumer), latencyTarget);
+
+        return;
+    }
+
+    auto queue = stageTracer->segment("queue " + name);
+    auto handler = stageTracer->segment("handler " + name);
+
+    d.addConsumer(name, priority, [consumer, queue, handler](const EventBatch &b) {
+        if (b.traceCopied == 0) {
+            consumer(b);
+
+            return;
+        }
+
+        auto started = traceTicks();
+
+        consumer(b);
+        stageTracer->record(queue, b.traceCopied, started);
+        stageTracer->record(handler, started, traceTicks());
+    }, latencyTarget);
+}
+
+// The "sink <name>" trace segment of an output, if stages are traced.
+inline std::size_t sinkSegment(const std::string &name) {
+    return stageTracer ? stageTracer->segment("sink " + name) : 0;
+}
+
+// Runs a sink write, timing it into `segment` if the batch is sampled.
+template<typename Write>
+void timeSinkWrite(std::size_t segment, const EventBatch &b, Write write) {
+    auto started = b.traceCopied != 0 ? traceTicks() : 0;
+
+    write();
+
+    if (started != 0) {
+        stageTracer->record(segment, started, traceTicks());
+    }
+}
+
+// Consumer stages: each consumer is a Pipeline of them after the lane or ring boundary, so its work is inlined and
+// timed per stage like the listener's.
+struct QuoteFilterStage {
+    static const char *name() {
+        return "quotes";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        return b.eventType == DXF_ET_QUOTE;
+    }
+};
+
+// The stale monitor goes before the book, see StaleQuoteMonitor::onQuote.
+struct StaleMonitorStage {
+    static const char *name() {
+        return "stale-monitor";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        if (staleQuoteMonitor) {
+            staleQuoteMonitor->onQuote(b.symbolId);
+        }
+
+        return true;
+    }
+};
+
+struct BookStage {
+    static const char *name() {
+        return "book";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        topOfBook->update(b.symbolId, b.events<dxf_quote_t>(), b.count);
+
+        return true;
+    }
+};
+
+struct OptionChainsStage {
+    static const char *name() {
+        return "greeks";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        optionChains->onQuotes(b.symbolId, b.events<dxf_quote_t>(), b.count);
+
+        return true;
+    }
+};
+
+struct BasketsStage {
+    static const char *name() {
+        return "baskets";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        basketEngine->onQuotes(b.symbolId, b.events<dxf_quote_t>(), b.count);
+
+        return true;
+    }
+};
+
+struct CurrencyGraphStage {
+    static const char *name() {
+        return "triangles";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        currencyGraph->onQuotes(b.symbolId, b.events<dxf_quote_t>(), b.count);
+
+        return true;
+    }
+};
+
+struct ChainWindowsStage {
+    static const char *name() {
+        return "windows";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        chainWindows->onQuotes(b.symbolId, b.events<dxf_quote_t>(), b.count);
+
+        return true;
+    }
+};
+
+struct TimelineStage {
+    static const char *name() {
+        return "reorder";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        if (b.eventType == DXF_ET_QUOTE) {
+            eventTimeline->onQuotes(b.symbolId, b.events<dxf_quote_t>(), b.count);
+        } else if (b.eventType == DXF_ET_TRADE) {
+            eventTimeline->onTrades(b.symbolId, b.events<dxf_trade_t>(), b.count);
+        } else if (b.eventType == DXF_ET_ORDER) {
+            eventTimeline->onOrders(b.symbolId, b.events<dxf_order_t>(), b.count);
+        }
+
+        return true;
+    }
+};
+
+// Sink stages also time their write into the "sink <name>" trace segment.
+struct TapeStage {
+    std::size_t sinkWrite{sinkSegment("tape")};
+
+    static const char *name() {
+        return "sink";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        timeSinkWrite(sinkWrite, b, [&b] {
+            if (b.eventType == DXF_ET_QUOTE) {
+                tapeRecorder->recordQuotes(b.symbolId, b.events<dxf_quote_t>(), b.count);
+            } else if (b.eventType == DXF_ET_TRADE) {
+                tapeRecorder->recordTrades(b.symbolId, b.events<dxf_trade_t>(), b.count, b.sides());
+            }
+        });
+
+        return true;
+    }
+};
+
+struct TextLogStage {
+    std::size_t sinkWrite{sinkSegment("text-log")};
+
+    static const char *name() {
+        return "sink";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        auto lines = formatBatch(b);
+
+        timeSinkWrite(sinkWrite, b, [&lines] {
+            textLog->write(lines.data(), lines.size());
+        });
+
+        return true;
+    }
+};
+
+struct AttachedStage {
+    std::size_t sinkWrite{sinkSegment("attached")};
+
+    static const char *name() {
+        return "sink";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        std::lock_guard<std::mutex> lock{attachedSink->mutex};
+
+        if (attachedSink->sink) {
+            auto lines = formatBatch(b);
+
+            timeSinkWrite(sinkWrite, b, [&lines] {
+                attachedSink->sink->write(lines.data(), lines.size());
+            });
+        }
+
+        return true;
+    }
+};
+
+struct BinaryStage {
+    std::size_t sinkWrite{sinkSegment("binary")};
+
+    static const char *name() {
+        return "sink";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        timeSinkWrite(sinkWrite, b, [&b] {
+            if (b.eventType == DXF_ET_QUOTE) {
+                binaryWriter->writeQuotes(b.symbolId, b.events<dxf_quote_t>(), b.count);
+            } else if (b.eventType == DXF_ET_TRADE) {
+                binaryWriter->writeTrades(b.symbolId, b.events<dxf_trade_t>(), b.count, b.sides());
+            }
+        });
+
+        return true;
+    }
+};
+
+struct ConsoleStage {
+    static const char *name() {
+        return "print";
+    }
+
+    bool operator()(const EventBatch &b) const {
+        b.print(b);
+
+        return true;
+    }
+};
+
+// Registers a consumer made of the pipeline of `Stages`; its stages are reported as "<name>.<stage>".
+template<typename... Stages, typename Fanout>
+void addPipelineConsumer(Fanout &d, const std::string &name, LanePriority priority,
+                         std::chrono::microseconds latencyTarget = std::chrono::microseconds(0)) {
+    auto pipeline = std::make_shared<Pipeline<Stages...>>();
+
+    consumerPipelineReports().emplace_back([pipeline, name](std::string &text) {
+        pipeline->report(text, name + ".");
+    });
+    addConsumer(d, name, priority, [pipeline](const EventBatch &b) {
+        (*pipeline)(b);
+    }, latencyTarget);
+}
+
+// Latency-critical state (top of book, analytics engines, timeline) gets dedicated lanes; recording and console
+// output share the bulk lanes. Consumers that only need the latest state of a symbol declare `latencyTarget` and are
+// conflated when they fall behind. Conflation merges the batches of all subscriptions of a symbol, so outputs, which
+// print or record each subscription's events, never declare it: the timeline, recorders and console always get the
+// full stream. Consumers are passed the batch's symbol id (interned in globalSymbols(), which they all share) rather
+// than its name. `Fanout` is the Dispatcher or, with --ring, the EventRing.
+template<typename Fanout>
+void registerConsumers(Fanout &d, std::chrono::microseconds latencyTarget) {
+    if (topOfBook) {
+        addPipelineConsumer<QuoteFilterStage, StaleMonitorStage, BookStage>(d, "top-of-book", LanePriority::CRITICAL,
+                                                                            latencyTarget);
+    }
+
+    if (optionChains) {
+        addPipelineConsumer<QuoteFilterStage, OptionChainsStage>(d, "option-chains", LanePriority::CRITICAL,
+                                                                 latencyTarget);
+    }
+
+    if (basketEngine) {
+        addPipelineConsumer<QuoteFilterStage, BasketsStage>(d, "baskets", LanePriority::CRITICAL, latencyTarget);
+    }
+
+    if (currencyGraph) {
+        addPipelineConsumer<QuoteFilterStage, CurrencyGraphStage>(d, "currency-graph", LanePriority::CRITICAL,
+                                                                  latencyTarget);
+    }
+
+    if (chainWindows) {
+        addPipelineConsumer<QuoteFilterStage, ChainWindowsStage>(d, "chain-windows", LanePriority::CRITICAL,
+                                                                 latencyTarget);
+    }
+
+    if (eventTimeline) {
+        addPipelineConsumer<TimelineStage>(d, "timeline", LanePriority::CRITICAL);
+    }
+
+    if (tapeRecorder) {
+        addPipelineConsumer<TapeStage>(d, "tape", LanePriority::BULK);
+    }
+
+    if (textLog) {
+        addPipelineConsumer<TextLogStage>(d, "text-log", LanePriority::BULK);
+    }
+
+    if (attachedSink) {
+        addPipelineConsumer<AttachedStage>(d, "attached", LanePriority::BULK);
+    }
+
+    if (outputMode == OutputMode::BINARY) {
+        addPipelineConsumer<BinaryStage>(d, "binary", LanePriority::BULK);
+    } else if (outputMode == OutputMode::TEXT) {
+        addPipelineConsumer<ConsoleStage>(d, "console", LanePriority::BULK);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    SubscriptionOptions subscriptionOptions{};
+    std::size_t historyCapacity = 0;
+    bool classifyTrades = false;
+    int dashboardFps = 10;
+    std::string textLogPath{};
+    std::string tapePath{};
+    bool useIoUring = false;
+    bool tapeDirect = false;
+    bool compressText = false;
+    std::string greeksPath{};
+    double riskFreeRate = 0.0;
+    int greeksPeriod = 5;
+    std::string basketsPath{};
+    int basketPeriod = 5;
+    std::string currencyPairsPath{};
+    int graphPeriod = 5;
+    int staleTimeout = 0;
+    bool timeline = false;
+    std::string universePath{};
+    int universePoll = 1;
+    int bulkLanes = 1;
+    long ringSlots = 0;
+    long latencyTargetUs = 0;
+    std::string backfillPath{};
+    BackfillConfig backfillConfig{};
+    int backfillMinutes = 60;
+    std::string ipfPath{};
+    std::vector<std::string> ipfTypes{};
+    std::vector<std::wstring> chainUnderlyings{};
+    int chainStrikes = 5;
+    int chainExpiries = 3;
+    long traceEvery = 0;
+    std::string controlPath{};
+    double paceRate = 0.0;
+    double paceBurst = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--binary") == 0) {
+            outputMode = OutputMode::BINARY;
+        } else if (std::strcmp(argv[i], "--output-policy") == 0 && i + 1 < argc) {
+            if (!parseOutputPolicy(argv[++i], subscriptionOptions.outputPolicy)) {
+                std::wcerr << L"Invalid output policy: " << argv[i] << std::endl;
+
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--summary-period") == 0 && i + 1 < argc) {
+            subscriptionOptions.outputPolicy.summaryPeriod = std::chrono::seconds(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--trades") == 0) {
+            subscriptionOptions.eventTypes |= DXF_ET_TRADE;
+        } else if (std::strcmp(argv[i], "--classify-trades") == 0) {
+            subscriptionOptions.eventTypes |= DXF_ET_TRADE;
+            classifyTrades = true;
+        } else if (std::strcmp(argv[i], "--dashboard") == 0) {
+            outputMode = OutputMode::DASHBOARD;
+        } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            dashboardFps = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--text-file") == 0 && i + 1 < argc) {
+            textLogPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--tape") == 0 && i + 1 < argc) {
+            tapePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--io-uring") == 0) {
+            useIoUring = true;
+        } else if (std::strcmp(argv[i], "--tape-direct") == 0) {
+            tapeDirect = true;
+        } else if (std::strcmp(argv[i], "--compress") == 0) {
+            compressText = true;
+        } else if (std::strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+            historyCapacity = static_cast<std::size_t>(std::atoll(argv[++i]));
+        } else if (std::strcmp(argv[i], "--greeks") == 0 && i + 1 < argc) {
+            greeksPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            riskFreeRate = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--greeks-period") == 0 && i + 1 < argc) {
+            greeksPeriod = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--baskets") == 0 && i + 1 < argc) {
+            basketsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--basket-period") == 0 && i + 1 < argc) {
+            basketPeriod = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--currency-graph") == 0 && i + 1 < argc) {
+            currencyPairsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--graph-period") == 0 && i + 1 < argc) {
+            graphPeriod = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--stale-timeout") == 0 && i + 1 < argc) {
+            staleTimeout = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--universe") == 0 && i + 1 < argc) {
+            universePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--universe-poll") == 0 && i + 1 < argc) {
+            universePoll = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            ipfPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--ipf-types") == 0 && i + 1 < argc) {
+            std::istringstream list{argv[++i]};
+
+            for (std::string type{}; std::getline(list, type, ',');) {
+                if (!type.empty()) {
+                    ipfTypes.push_back(type);
+                }
+            }
+        } else if (std::strcmp(argv[i], "--chains") == 0 && i + 1 < argc) {
+            std::istringstream list{argv[++i]};
+
+            for (std::string underlying{}; std::getline(list, underlying, ',');) {
+                if (!underlying.empty()) {
+                    chainUnderlyings.push_back(StringConverter::toWString(underlying));
+                }
+            }
+        } else if (std::strcmp(argv[i], "--chain-strikes") == 0 && i + 1 < argc) {
+            chainStrikes = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--chain-expiries") == 0 && i + 1 < argc) {
+            chainExpiries = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trace-sample") == 0 && i + 1 < argc) {
+            traceEvery = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--pace") == 0 && i + 1 < argc) {
+            paceRate = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--pace-burst") == 0 && i + 1 < argc) {
+            paceBurst = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--control") == 0 && i + 1 < argc) {
+            controlPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--backfill") == 0 && i + 1 < argc) {
+            backfillPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--backfill-minutes") == 0 && i + 1 < argc) {
+            backfillMinutes = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--backfill-connections") == 0 && i + 1 < argc) {
+            backfillConfig.connections = static_cast<std::size_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::strcmp(argv[i], "--backfill-chunk") == 0 && i + 1 < argc) {
+            backfillConfig.symbolsPerChunk = static_cast<std::size_t>(std::max(std::atoi(argv[++i]), 1));
+        } else if (std::strcmp(argv[i], "--latency-target") == 0 && i + 1 < argc) {
+            latencyTargetUs = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--ring") == 0 && i + 1 < argc) {
+            ringSlots = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--bulk-lanes") == 0 && i + 1 < argc) {
+            bulkLanes = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--timeline") == 0) {
+            subscriptionOptions.eventTypes |= DXF_ET_TRADE | DXF_ET_ORDER;
+            timeline = true;
+        }
+    }
+
+    if (outputMode == OutputMode::BINARY) {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        binaryWriter.reset(new BinaryWriter(stdout, globalSymbols()));
+    }
+
+    if (!textLogPath.empty()) {
+        textLog = openFileSink(textLogPath, useIoUring);
+
+        if (!textLog) {
+            std::wcerr << L"Cannot open " << textLogPath.c_str() << std::endl;
+
+            return 1;
+        }
+
+        if (compressText) {
+            textLog.reset(new CompressingFileSink(std::move(textLog)));
+        }
+    }
+
+    if (!tapePath.empty()) {
+        auto sink = tapeDirect ? openDirectFileSink(tapePath) : openFileSink(tapePath, useIoUring);
+
+        if (!sink) {
+            std::wcerr << L"Cannot open " << tapePath.c_str() << std::endl;
+
+            return 1;
+        }
+
+        tapeRecorder.reset(new TapeRecorder(std::move(sink), globalSymbols()));
+    }
+
+    if (historyCapacity != 0) {
+        quoteHistory.reset(new QuoteHistory(historyCapacity, globalSymbols()));
+    }
+
+    if (classifyTrades) {
+        // The classifier looks up the quote prevailing at a trade, which is among the latest few of its symbol.
+        if (!quoteHistory) {
+            quoteHistory.reset(new QuoteHistory(1024, globalSymbols()));
+        }
+
+        tradeClassifier.reset(new TradeClassifier(*quoteHistory));
+    }
+
+    // Reports (option Greeks, basket values, cross rates) and other timed work; stopped before shutdown.
+    PeriodicTasks periodic{};
+    std::vector<std::wstring> chainSymbols{};
+
+    if (!greeksPath.empty()) {
+        optionChains.reset(new OptionChains(globalSymbols(), riskFreeRate));
+
+        for (auto &option : readSymbolFile(greeksPath)) {
+            if (!optionChains->addOption(option)) {
+                log("Not an option symbol: {}\n", StringConverter::toString(option));
+            }
+        }
+
+        chainSymbols = optionChains->subscriptionSymbols();
+        periodic.add(
+            [] {
+                log("{}", optionChains->toText());
+            },
+            std::chrono::seconds(std::max(greeksPeriod, 1)));
+    }
+
+    std::vector<std::wstring> basketSymbols{};
+
+    if (!basketsPath.empty()) {
+        std::string error{};
+
+        basketEngine.reset(new BasketEngine(globalSymbols()));
+
+        if (!basketEngine->load(basketsPath, error)) {
+            std::wcerr << error.c_str() << std::endl;
+
+            return 1;
+        }
+
+        basketSymbols = basketEngine->subscriptionSymbols();
+        periodic.add(
+            [] {
+                log("{}", basketEngine->toText());
+            },
+            std::chrono::seconds(std::max(basketPeriod, 1)));
+    }
+
+    std::vector<std::wstring> pairSymbols{};
+
+    if (!currencyPairsPath.empty()) {
+        currencyGraph.reset(new CurrencyGraph(globalSymbols()));
+
+        for (auto &pair : readSymbolFile(currencyPairsPath)) {
+            if (!currencyGraph->addPair(pair)) {
+                log("Not a currency pair: {}\n", StringConverter::toString(pair));
+            }
+        }
+
+        pairSymbols = currencyGraph->subscriptionSymbols();
+        log("Currency graph: {} pairs, {} triangles\n", pairSymbols.size(), currencyGraph->triangleCount());
+        periodic.add(
+            [] {
+                log("{}", currencyGraph->toText());
+            },
+            std::chrono::seconds(std::max(graphPeriod, 1)));
+    }
+
+    std::vector<std::wstring> profileSymbols{};
+
+    if (!ipfPath.empty()) {
+        InstrumentProfiles profiles{globalSymbols()};
+        std::string error{};
+        auto started = std::chrono::steady_clock::now();
+
+        if (!profiles.load(ipfPath, error)) {
+            std::wcerr << error.c_str() << std::endl;
+
+            return 1;
+        }
+
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+
+        profileSymbols = profiles.symbolsOf(ipfTypes);
+        log("Instrument profiles: {} ({}), {} skipped, loaded in {} ms; subscribing to {}\n", profiles.all().size(),
+            countProfileTypes(profiles), profiles.skippedCount(), elapsed, profileSymbols.size());
+
+        if (!chainUnderlyings.empty()) {
+            std::vector<std::uint32_t> underlyingIds{};
+
+            chainWindows.reset(new ChainWindows(globalSymbols(), static_cast<std::size_t>(std::max(chainStrikes, 0)),
+                                                static_cast<std::size_t>(std::max(chainExpiries, 1))));
+            globalSymbols().internAll(chainUnderlyings, underlyingIds);
+
+            for (auto &p : profiles.all()) {
+                if (profiles.typeName(p.type) != "OPTION" ||
+                    std::find(underlyingIds.begin(), underlyingIds.end(), p.underlyingId) == underlyingIds.end()) {
+                    continue;
+                }
+
+                auto option = globalSymbols().name(p.symbolId);
+
+                if (!chainWindows->addOption(option)) {
+                    log("Not an option symbol: {}\n", StringConverter::toString(option));
+                }
+            }
+
+            log("Chain windows: {} options of {} underlyings, {} strikes around ATM, {} expiries\n",
+                chainWindows->size(), chainUnderlyings.size(), std::max(chainStrikes, 0), std::max(chainExpiries, 1));
+        }
+    } else if (!chainUnderlyings.empty()) {
+        log("Chain windows need instrument profiles (--ipf)\n");
+    }
+
+    std::unique_ptr<Dashboard> dashboard{};
+
+    if (outputMode == OutputMode::DASHBOARD) {
+        topOfBook.reset(new TopOfBook(globalSymbols()));
+        dashboard.reset(new Dashboard(*topOfBook, stdout, dashboardFps));
+    }
+
+    if (staleTimeout > 0) {
+        if (!topOfBook) {
+            topOfBook.reset(new TopOfBook(globalSymbols()));
+        }
+
+        staleQuoteMonitor.reset(new StaleQuoteMonitor(
+            *topOfBook, std::chrono::milliseconds(staleTimeout), [staleTimeout](std::uint32_t symbolId, bool stale) {
+                auto name = StringConverter::toString(globalSymbols().name(symbolId));
+
+                if (stale) {
+                    log("Stale: {}: no quote for {} ms\n", name, staleTimeout);
+                } else {
+                    log("Stale: {}: quotes resumed\n", name);
+                }
+            }));
+        staleQuoteMonitor->start();
+    }
+
+    if (dashboard) {
+        dashboard->start();
+    }
+
+    if (timeline) {
+        eventTimeline.reset(new EventTimeline(globalSymbols(), [](const TimelineEvent &e) {
+            log("{}", formatTimelineEvent(e));
+        }));
+        eventTimeline->start();
+    }
+
+    if (!controlPath.empty()) {
+        attachedSink.reset(new AttachedSink{});
+    }
+
+    if (traceEvery > 0) {
+        stageTracer.reset(new StageTracer(static_cast<std::uint64_t>(traceEvery)));
+        stageTracer->segment("copy-out");
+    }
+
+    if (ringSlots > 0) {
+        eventRing.reset(new EventRing(static_cast<std::size_t>(ringSlots)));
+        registerConsumers(*eventRing, std::chrono::microseconds(0));
+
+        // Output follows the book, so a quote that has been printed or recorded is already in the top of book.
+        for (auto output : {"text-log", "attached", "binary", "console"}) {
+            eventRing->runAfter(output, "top-of-book");
+        }
+
+        eventRing->start();
+    } else {
+        dispatcher.reset(new Dispatcher(static_cast<std::size_t>(std::max(bulkLanes, 1))));
+        registerConsumers(*dispatcher, std::chrono::microseconds(std::max(latencyTargetUs, 0L)));
+        dispatcher->start();
+    }
+
+    if (textLog || tapeRecorder || attachedSink) {
+        periodic.add(flushFileOutputs, std::chrono::seconds(1));
+    }
+
+    dxf_initialize_logger_v2("SUPDXFD-17424.log", true, true, true, false);
+    dxf_load_config_from_string("logger.level = \"debug\"\n");
+    auto symbol = L"ETH/USD";
+    auto address = "demo.dxfeed.com:7300";
+
+    dxf_connection_t c{};
+
+    auto result = dxf_create_connection(address, nullptr, nullptr, nullptr, nullptr, nullptr, &c);
+
+    if (result == DXF_FAILURE) {
+        processLastError();
+
+        return 1;
+    }
+
+    onScopeExit([&c] {
+        auto result = dxf_close_connection(c);
+
+        if (result == DXF_FAILURE) {
+            processLastError();
+        }
+    });
+
+    std::unique_ptr<ControlPacer> pacer{};
+
+    if (paceRate > 0.0) {
+        pacer.reset(new ControlPacer(paceRate, paceBurst, processLastError));
+        subscriptionOptions.pacer = pacer.get();
+    }
+
+    std::vector<std::unique_ptr<SubscriptionBase>> subs{};
+
+    subs.emplace_back(new Subscription<1>(c, symbol, subscriptionOptions));
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    subs.emplace_back(new Subscription<2>(c, symbol, subscriptionOptions));
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    subs.emplace_back(new Subscription<3>(c, symbol, subscriptionOptions));
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    subs.emplace_back(new Subscription<4>(c, symbol, subscriptionOptions));
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    subs.emplace_back(new Subscription<5>(c, symbol, subscriptionOptions));
+
+    if (!chainSymbols.empty()) {
+        auto chainSubscription = new Subscription<6>(c, nullptr, subscriptionOptions);
+
+        subs.emplace_back(chainSubscription);
+        chainSubscription->addSymbols(chainSymbols);
+    }
+
+    if (!basketSymbols.empty()) {
+        auto basketSubscription = new Subscription<7>(c, nullptr, subscriptionOptions);
+
+        subs.emplace_back(basketSubscription);
+        basketSubscription->addSymbols(basketSymbols);
+    }
+
+    if (!pairSymbols.empty()) {
+        auto pairSubscription = new Subscription<8>(c, nullptr, subscriptionOptions);
+
+        subs.emplace_back(pairSubscription);
+        pairSubscription->addSymbols(pairSymbols);
+    }
+
+    std::atomic<bool> watchingUniverse{false};
+    std::thread universeWatcher{};
+
+    if (!universePath.empty()) {
+        auto universeSubscription = new Subscription<9>(c, nullptr, subscriptionOptions);
+
+        subs.emplace_back(universeSubscription);
+        watchingUniverse = true;
+        universeWatcher = std::thread(watchUniverse<Subscription<9>>, universePath,
+                                      std::chrono::seconds(std::max(universePoll, 1)), universeSubscription,
+                                      std::ref(watchingUniverse));
+    }
+
+    if (!profileSymbols.empty()) {
+        auto profileSubscription = new Subscription<11>(c, nullptr, subscriptionOptions);
+        SymbolUniverse universe{globalSymbols()};
+
+        subs.emplace_back(profileSubscription);
+        universe.reconcile(
+            profileSymbols,
+            [profileSubscription](const std::vector<std::wstring> &batch) {
+                return profileSubscription->addSymbols(batch);
+            },
+            [](const std::vector<std::wstring> &) {
+                return readyFuture(true);
+            });
+    }
+
+    std::atomic<bool> answeringQueries{false};
+    std::thread queryReader{};
+
+    if (historyCapacity != 0) {
+#ifndef _WIN32
+        answeringQueries = true;
+        queryReader = std::thread(runHistoryQueries, std::ref(*quoteHistory), std::ref(answeringQueries));
+#else
+        log("History queries from stdin are not supported on this platform\n");
+#endif
+    }
+
+    std::atomic<bool> maintainingChains{false};
+    std::thread chainMaintainer{};
+
+    if (chainWindows) {
+        auto windowSubscription = new Subscription<12>(c, nullptr, subscriptionOptions);
+
+        subs.emplace_back(windowSubscription);
+
+        // Only the underlyings until their first quotes place the windows.
+        chainWindows->apply(
+            [windowSubscription](const std::vector<std::wstring> &batch) {
+                return windowSubscription->addSymbols(batch);
+            },
+            [windowSubscription](const std::vector<std::wstring> &batch) {
+                return windowSubscription->removeSymbols(batch);
+            });
+        maintainingChains = true;
+        chainMaintainer = std::thread(maintainChainWindows<Subscription<12>>, windowSubscription,
+                                      std::ref(maintainingChains));
+    }
+
+    std::unique_ptr<Backfill> backfill{};
+    std::thread backfillThread{};
+
+    if (!backfillPath.empty()) {
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+
+        backfillConfig.address = address;
+        backfillConfig.to = now;
+        backfillConfig.from = now - std::int64_t{std::max(backfillMinutes, 1)} * 60000;
+        backfill.reset(new Backfill(globalSymbols(), backfillConfig, writeBackfill));
+        backfillThread = std::thread([&backfill, c, symbols = readSymbolFile(backfillPath)] {
+            auto stats = backfill->run(c, symbols);
+
+            log("Backfill: {} events of {} symbols from {} chunks ({} failed) over {} connections in {} ms, {} live "
+                "events held{}\n",
+                stats.events, symbols.size(), stats.chunks, stats.failedChunks, stats.connections, stats.elapsedMillis,
+                stats.heldLiveEvents, stats.live ? "" : ", live subscription failed");
+        });
+    }
+
+#ifdef SUPDXFD_HAVE_CONTROL_SOCKET
+    std::unique_ptr<ControlServer> controlServer{};
+
+    if (!controlPath.empty()) {
+        auto controlSubscription = new Subscription<13>(c, nullptr, subscriptionOptions);
+        std::string error{};
+
+        subs.emplace_back(controlSubscription);
+        controlServer = ControlServer::open(
+            controlPath, ControlCommands<Subscription<13>>(controlSubscription, subs, subscriptionOptions.outputPolicy),
+            error);
+
+        if (controlServer) {
+            controlServer->start();
+            log("Control socket: {}\n", controlPath);
+        } else {
+            log("{}\n", error);
+        }
+    }
+#else
+    if (!controlPath.empty()) {
+        log("The control socket is not supported on this platform\n");
+    }
+#endif
+
+    // Summaries of suppressed console output are due even while a subscription prints nothing.
+    if (outputMode == OutputMode::TEXT) {
+        periodic.add(
+            [&subs] {
+                for (auto &sub : subs) {
+                    sub->printSummary(false);
+                }
+            },
+            std::chrono::seconds(1));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+
+    subs[2]->Close();
+
+    std::this_thread::sleep_for(std::chrono::seconds(5));
+
+    periodic.stop();
+    watchingUniverse = false;
+
+    if (universeWatcher.joinable()) {
+        universeWatcher.join();
+    }
+
+    answeringQueries = false;
+
+    if (queryReader.joinable()) {
+        queryReader.join();
+    }
+
+#ifdef SUPDXFD_HAVE_CONTROL_SOCKET
+    controlServer.reset();
+#endif
+
+    maintainingChains = false;
+
+    if (chainMaintainer.joinable()) {
+        chainMaintainer.join();
+    }
+
+    if (backfill) {
+        backfill->cancel();
+    }
+
+    if (backfillThread.joinable()) {
+        backfillThread.join();
+    }
+
+    if (backfill) {
+        backfill->close();
+    }
+
+    for (auto &sub : subs) {
+        sub->Close();
+    }
+
+    if (eventRing) {
+        eventRing->stop();
+        log("{}", eventRing->stats());
+    } else {
+        dispatcher->stop();
+        log("{}", dispatcher->stats());
+    }
+
+    // Delivers what the timeline still holds while the symbol table its output uses is alive.
+    if (eventTimeline) {
+        eventTimeline->stop();
+        eventTimeline.reset();
+    }
+
+    flushFileOutputs();
+
+    // The console has printed everything it will, so the last counts are final.
+    if (outputMode == OutputMode::TEXT) {
+        for (auto &sub : subs) {
+            sub->printSummary(true);
+        }
+    }
+
+    subs.clear();
+
+    log("{}{}", listenerPipeline().report(), consumerPipelinesReport());
+
+    if (stageTracer) {
+        log("{}", stageTracer->toText());
+    }
+
+    if (pacer) {
+        log("Control calls: {}\n", pacer->toText());
+    }
 
     return 0;
 }
@@ -0,0 +1,113 @@
+// Copyright (c) 2024 Devexperts LLC.
+// SPDX-License-Identifier: MPL-2.0
+
+// Decompresses files written with `--compress` to stdout. Blocks are independent, so each window of blocks is
+// decompressed by several threads and written out in order.
+//
+// Usage: LzCat <file> [threads]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "../LzCodec.hpp"
+
+struct BlockRef {
+    lz::BlockHeader header;
+    std::vector<char> payload;
+    std::vector<char> output;
+    bool ok;
+};
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <file> [threads]\n", argv[0]);
+
+        return 1;
+    }
+
+    auto *in = std::fopen(argv[1], "rb");
+
+    if (!in) {
+        std::perror(argv[1]);
+
+        return 1;
+    }
+
+    unsigned threads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+
+    threads = std::max(threads, 1u);
+
+    const std::size_t window = threads * 4;
+    std::vector<BlockRef> blocks{};
+    bool eof = false;
+    int result = 0;
+
+    while (!eof && result == 0) {
+        blocks.clear();
+
+        while (blocks.size() < window) {
+            BlockRef block{};
+
+            if (std::fread(&block.header, sizeof(block.header), 1, in) != 1) {
+                eof = true;
+
+                break;
+            }
+
+            if (block.header.magic != lz::BLOCK_MAGIC) {
+                std::fprintf(stderr, "%s: bad block magic\n", argv[1]);
+                result = 1;
+
+                break;
+            }
+
+            block.payload.resize(block.header.storedSize);
+
+            if (block.header.storedSize != 0 &&
+                std::fread(block.payload.data(), block.header.storedSize, 1, in) != 1) {
+                std::fprintf(stderr, "%s: truncated block\n", argv[1]);
+                result = 1;
+
+                break;
+            }
+
+            blocks.push_back(std::move(block));
+        }
+
+        std::atomic<std::size_t> next{0};
+        std::vector<std::thread> workers{};
+
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&] {
+                for (auto i = next++; i < blocks.size(); i = next++) {
+                    auto &b = blocks[i];
+
+                    b.ok = lz::decompressBlock(b.header, b.payload.data(), b.output);
+                }
+            });
+        }
+
+        for (auto &w : workers) {
+            w.join();
+        }
+
+        for (auto &b : blocks) {
+            if (!b.ok) {
+                std::fprintf(stderr, "%s: corrupted block\n", argv[1]);
+                result = 1;
+
+                break;
+            }
+
+            std::fwrite(b.output.data(), 1, b.output.size(), stdout);
+        }
+    }
+
+    std::fclose(in);
+
+    return result;
+}